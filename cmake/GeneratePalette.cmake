@@ -0,0 +1,149 @@
+# Compiles src/assets/palette.json into constexpr theme tables (types in src/ui/Palette.h).
+#
+#   cmake -DINPUT=<palette.json> -DOUTPUT=<PaletteData.h> -P GeneratePalette.cmake
+#
+# Themes are emitted sorted by "order", each theme's accents as color indices sorted by the
+# accent "order", so the application does no parsing, hashing or sorting at startup.
+
+cmake_minimum_required(VERSION 3.19)
+
+if(NOT INPUT OR NOT OUTPUT)
+  message(FATAL_ERROR "GeneratePalette.cmake needs -DINPUT=<json> and -DOUTPUT=<header>")
+endif()
+
+file(READ "${INPUT}" json)
+
+function(c_string out value)
+  string(REPLACE "\\" "\\\\" value "${value}")
+  string(REPLACE "\"" "\\\"" value "${value}")
+  set(${out} "\"${value}\"" PARENT_SCOPE)
+endfunction()
+
+function(c_bool out value)
+  if(value)
+    set(${out} "true" PARENT_SCOPE)
+  else()
+    set(${out} "false" PARENT_SCOPE)
+  endif()
+endfunction()
+
+# Reads an optional member, falling back to a default when it is missing.
+function(json_get_or out default document)
+  string(JSON value ERROR_VARIABLE error GET "${document}" ${ARGN})
+  if(error)
+    set(value "${default}")
+  endif()
+  set(${out} "${value}" PARENT_SCOPE)
+endfunction()
+
+string(JSON rootCount LENGTH "${json}")
+set(themeKeys "")
+if(rootCount GREATER 0)
+  math(EXPR lastRoot "${rootCount} - 1")
+  foreach(i RANGE ${lastRoot})
+    string(JSON key MEMBER "${json}" ${i})
+    string(JSON type TYPE "${json}" "${key}")
+    if(NOT type STREQUAL "OBJECT")
+      continue()
+    endif()
+
+    string(JSON colorsType ERROR_VARIABLE error TYPE "${json}" "${key}" colors)
+    if(error OR NOT colorsType STREQUAL "OBJECT")
+      continue()
+    endif()
+
+    json_get_or(order 0 "${json}" "${key}" order)
+    list(APPEND themeKeys "${order}:${key}")
+  endforeach()
+endif()
+
+if(NOT themeKeys)
+  message(FATAL_ERROR "${INPUT} does not define any theme with colors")
+endif()
+
+list(SORT themeKeys COMPARE NATURAL)
+
+set(body "")
+set(themeRows "")
+set(themeIndex 0)
+foreach(entry IN LISTS themeKeys)
+  string(REGEX REPLACE "^[^:]*:" "" key "${entry}")
+  string(JSON theme GET "${json}" "${key}")
+  string(JSON colors GET "${theme}" colors)
+
+  json_get_or(name "${key}" "${theme}" name)
+  json_get_or(emoji "" "${theme}" emoji)
+  json_get_or(dark OFF "${theme}" dark)
+  json_get_or(order 0 "${theme}" order)
+
+  set(colorRows "")
+  set(accentKeys "")
+  set(colorIndex 0)
+  string(JSON colorCount LENGTH "${colors}")
+  if(colorCount GREATER 0)
+    math(EXPR lastColor "${colorCount} - 1")
+    foreach(j RANGE ${lastColor})
+      string(JSON colorId MEMBER "${colors}" ${j})
+      string(JSON colorType TYPE "${colors}" "${colorId}")
+      if(NOT colorType STREQUAL "OBJECT")
+        continue()
+      endif()
+
+      string(JSON color GET "${colors}" "${colorId}")
+      json_get_or(colorName "${colorId}" "${color}" name)
+      json_get_or(hex "" "${color}" hex)
+      json_get_or(accent OFF "${color}" accent)
+      json_get_or(colorOrder 0 "${color}" order)
+
+      c_string(idLiteral "${colorId}")
+      c_string(nameLiteral "${colorName}")
+      c_string(hexLiteral "${hex}")
+      c_bool(accentLiteral "${accent}")
+      string(APPEND colorRows
+             "    {${idLiteral}, ${nameLiteral}, ${hexLiteral}, ${accentLiteral}, ${colorOrder}},\n")
+
+      if(accent)
+        list(APPEND accentKeys "${colorOrder}:${colorIndex}")
+      endif()
+      math(EXPR colorIndex "${colorIndex} + 1")
+    endforeach()
+  endif()
+
+  set(colorsSymbol "nullptr")
+  if(colorIndex GREATER 0)
+    set(colorsSymbol "kTheme${themeIndex}Colors")
+    string(APPEND body "inline constexpr Color ${colorsSymbol}[] = {\n${colorRows}};\n\n")
+  endif()
+
+  set(accentsSymbol "nullptr")
+  list(LENGTH accentKeys accentCount)
+  if(accentCount GREATER 0)
+    list(SORT accentKeys COMPARE NATURAL)
+    set(accentIndices "")
+    foreach(accentEntry IN LISTS accentKeys)
+      string(REGEX REPLACE "^[^:]*:" "" accentIndex "${accentEntry}")
+      list(APPEND accentIndices "${accentIndex}")
+    endforeach()
+    list(JOIN accentIndices ", " accentIndices)
+    set(accentsSymbol "kTheme${themeIndex}Accents")
+    string(APPEND body "inline constexpr int ${accentsSymbol}[] = {${accentIndices}};\n\n")
+  endif()
+
+  c_string(idLiteral "${key}")
+  c_string(nameLiteral "${name}")
+  c_string(emojiLiteral "${emoji}")
+  c_bool(darkLiteral "${dark}")
+  string(APPEND themeRows
+         "    {${idLiteral}, ${nameLiteral}, ${emojiLiteral}, ${darkLiteral}, ${order}, "
+         "${colorsSymbol}, ${colorIndex}, ${accentsSymbol}, ${accentCount}},\n")
+  math(EXPR themeIndex "${themeIndex} + 1")
+endforeach()
+
+set(content "// Generated from palette.json by cmake/GeneratePalette.cmake. Do not edit.\n\n")
+string(APPEND content "#pragma once\n\n#include \"ui/Palette.h\"\n\nnamespace palette {\n\n")
+string(APPEND content "${body}")
+string(APPEND content "inline constexpr Theme kThemes[] = {\n${themeRows}};\n\n")
+string(APPEND content "inline constexpr std::size_t kThemeCount = ${themeIndex};\n\n")
+string(APPEND content "} // namespace palette\n")
+
+file(WRITE "${OUTPUT}" "${content}")
@@ -0,0 +1,228 @@
+#include "cli/CommandLine.h"
+
+#include "cli/DirectoryAudit.h"
+#include "cli/HomeAudit.h"
+#include "cli/NdjsonExport.h"
+#include "cli/QueryClient.h"
+#include "cli/QueryDaemon.h"
+#include "cli/ResolveBenchmark.h"
+#include "cli/UiBenchmark.h"
+#include "services/AppRegistry.h"
+#include "services/EntrySnapshot.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+#include "services/MimeappsCompactor.h"
+#include "utils/RuntimeCounters.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <cstddef>
+
+namespace {
+// Flags that select a headless mode; checked before any QApplication exists.
+const char *const HeadlessFlags[] = {"--benchmark-resolve", "--audit-homes", "--audit-dir",
+                                     "--which", "--compact", "--daemon", "--query",
+                                     "--benchmark-query", "--export-ndjson", "--stats"};
+const char *const OffscreenFlags[] = {"--benchmark-ui"};
+
+template <std::size_t N>
+bool hasFlag(int argc, char *argv[], const char *const (&flags)[N]) {
+  for (int i = 1; i < argc; ++i) {
+    for (const char *flag : flags) {
+      if (qstrcmp(argv[i], flag) == 0) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// The same load the window does at startup: the snapshot when it is current, otherwise a full
+// resolve. Used when --stats is given without another mode.
+int runStartupPipeline(const XdgEnvironment &env, int threadCount) {
+  AppRegistry registry(env);
+  registry.load();
+  MimeDefaultsStore store(env);
+  store.reload();
+
+  const auto snapshot =
+      EntrySnapshot::open(EntrySnapshot::defaultPath(env), EntrySnapshot::fingerprint(env));
+  RuntimeCounters::add(snapshot ? RuntimeCounters::SnapshotHits
+                                : RuntimeCounters::SnapshotMisses);
+  if (!snapshot) {
+    MimeAssociationService(&registry, &store).buildEntries(threadCount);
+  }
+
+  return 0;
+}
+} // namespace
+
+bool CommandLine::isHeadless(int argc, char *argv[]) {
+  return hasFlag(argc, argv, HeadlessFlags);
+}
+
+bool CommandLine::isOffscreen(int argc, char *argv[]) {
+  return hasFlag(argc, argv, OffscreenFlags);
+}
+
+int CommandLine::run(const QStringList &arguments) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Inspect and change default applications for MIME types.");
+  parser.addHelpOption();
+
+  const QCommandLineOption benchmarkOption(
+      "benchmark-resolve", "Time the full association build at 1, 2, 4, 8 and 16 threads.");
+  const QCommandLineOption repeatOption(
+      "repeat", "Runs per thread count, or passes over all types for --benchmark-query.", "count",
+      "5");
+  const QCommandLineOption auditOption(
+      "audit-homes",
+      "Report effective defaults and broken entries for every home listed in <file> "
+      "(one path per line, inside --root; - reads standard input).",
+      "file");
+  const QCommandLineOption whichOption(
+      "which", "Print the MIME type and opening application of <path>; repeatable.", "path");
+  const QCommandLineOption auditDirOption(
+      "audit-dir", "Classify every file under <dir> in parallel and report each file's type and "
+                   "opening application, then totals per type and per application (tab-separated; "
+                   "tabs, newlines and backslashes in paths are escaped as \\t, \\n and \\\\).",
+      "dir");
+  const QCommandLineOption uiBenchmarkOption(
+      "benchmark-ui", "Script search, expand, scroll, navigation, theme and accent scenarios on "
+                      "the offscreen platform and report frame timings as JSON (synthetic data "
+                      "unless --root is given).");
+  const QCommandLineOption reportOption("report", "Write the --benchmark-ui report to <file>.",
+                                        "file");
+  const QCommandLineOption compactOption(
+      "compact", "Drop uninstalled IDs, duplicate keys and empty sections from the user's "
+                 "mimeapps.list and report the size and parse-time reduction.");
+  const QCommandLineOption dryRunOption("dry-run", "With --compact, report without rewriting.");
+  const QCommandLineOption statsOption(
+      "stats", "Print parse, cache and resolution counters to standard error when done; on its "
+               "own, counts one startup load.");
+  const QCommandLineOption exportOption(
+      "export-ndjson", "Stream every resolved type to <file> (- for standard output) as one JSON "
+                       "object per line.",
+      "file");
+  const QCommandLineOption daemonOption(
+      "daemon", "Stay resident and answer default, apps and set requests on a local socket.");
+  const QCommandLineOption queryOption(
+      "query", "Send <request> (for example \"default text/html\") to a running --daemon and "
+               "print its reply.",
+      "request");
+  const QCommandLineOption queryBenchmarkOption(
+      "benchmark-query", "Time default queries for every type against a running --daemon.");
+  const QCommandLineOption socketOption(
+      "socket", "Local socket name for --daemon, --query and --benchmark-query.", "name",
+      QueryDaemon::defaultSocketName());
+  const QCommandLineOption rootOption(
+      "root", "Read system and user directories inside <dir> instead of the live system.", "dir");
+  const QCommandLineOption jobsOption("jobs", "Worker threads for parallel modes.", "count", "0");
+  parser.addOption(benchmarkOption);
+  parser.addOption(repeatOption);
+  parser.addOption(uiBenchmarkOption);
+  parser.addOption(reportOption);
+  parser.addOption(auditOption);
+  parser.addOption(whichOption);
+  parser.addOption(auditDirOption);
+  parser.addOption(compactOption);
+  parser.addOption(dryRunOption);
+  parser.addOption(statsOption);
+  parser.addOption(exportOption);
+  parser.addOption(daemonOption);
+  parser.addOption(queryOption);
+  parser.addOption(queryBenchmarkOption);
+  parser.addOption(socketOption);
+  parser.addOption(rootOption);
+  parser.addOption(jobsOption);
+  parser.process(arguments);
+
+  const auto runMode = [&]() -> int {
+    // Builds its own environment, since the synthetic tree has to exist before it is resolved.
+    if (parser.isSet(uiBenchmarkOption)) {
+      return UiBenchmark::run(parser.value(rootOption), parser.value(reportOption));
+    }
+
+    // Clients only talk to the daemon; they never load anything themselves.
+    if (parser.isSet(queryOption)) {
+      return QueryClient::run(parser.value(socketOption), parser.value(queryOption));
+    }
+
+    if (parser.isSet(queryBenchmarkOption)) {
+      return QueryClient::benchmark(parser.value(socketOption),
+                                    parser.value(repeatOption).toInt());
+    }
+
+    const XdgEnvironment env = XdgEnvironment::fromProcess(parser.value(rootOption));
+
+    if (parser.isSet(exportOption)) {
+      return NdjsonExport::run(env, parser.value(exportOption), parser.value(jobsOption).toInt());
+    }
+
+    if (parser.isSet(daemonOption)) {
+      return QueryDaemon::run(env, parser.value(socketOption));
+    }
+
+    if (parser.isSet(benchmarkOption)) {
+      return ResolveBenchmark::run(env, parser.value(repeatOption).toInt());
+    }
+
+    if (parser.isSet(auditOption)) {
+      return HomeAudit::run(env, parser.value(auditOption), parser.value(jobsOption).toInt());
+    }
+
+    if (parser.isSet(whichOption)) {
+      return DirectoryAudit::which(env, parser.values(whichOption));
+    }
+
+    if (parser.isSet(auditDirOption)) {
+      return DirectoryAudit::run(env, parser.value(auditDirOption),
+                                 parser.value(jobsOption).toInt());
+    }
+
+    if (parser.isSet(compactOption)) {
+      AppRegistry registry(env);
+      registry.load();
+
+      const CompactionReport report = MimeappsCompactor::compact(
+          env.userMimeappsPath(), registry, parser.isSet(dryRunOption));
+      QTextStream(report.ok ? stdout : stderr) << MimeappsCompactor::summary(report) << Qt::endl;
+      return report.ok ? 0 : 1;
+    }
+
+    if (parser.isSet(statsOption)) {
+      return runStartupPipeline(env, parser.value(jobsOption).toInt());
+    }
+
+    parser.showHelp(1);
+  };
+
+  const int exitCode = runMode();
+  if (parser.isSet(statsOption)) {
+    QTextStream(stderr) << RuntimeCounters::report() << Qt::endl;
+  }
+
+  return exitCode;
+}
+
+CommandLine::WindowOptions CommandLine::windowOptions(const QStringList &arguments) {
+  QCommandLineParser parser;
+  const QCommandLineOption selectOption("select", "Select <mime> in the window.", "mime");
+  const QCommandLineOption newInstanceOption(
+      "new-instance", "Open a separate window instead of reusing the running one.");
+  parser.addOption(selectOption);
+  parser.addOption(newInstanceOption);
+
+  // Unknown options are ignored rather than fatal: a launcher may pass anything.
+  parser.parse(arguments);
+
+  WindowOptions options;
+  options.selectMime = parser.value(selectOption);
+  options.newInstance = parser.isSet(newInstanceOption);
+  return options;
+}
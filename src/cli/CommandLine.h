@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Dispatches the modes that run without a visible window, and parses the window's options.
+class CommandLine {
+public:
+  // Options of the windowed mode; also what a second launch forwards to the running window.
+  struct WindowOptions {
+    QString selectMime;
+    bool newInstance = false;
+  };
+
+  static bool isHeadless(int argc, char *argv[]);
+  // Modes that need widgets but no display; main() runs them on the offscreen platform.
+  static bool isOffscreen(int argc, char *argv[]);
+  static int run(const QStringList &arguments);
+  static WindowOptions windowOptions(const QStringList &arguments);
+};
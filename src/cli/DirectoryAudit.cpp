@@ -0,0 +1,279 @@
+#include "cli/DirectoryAudit.h"
+
+#include "services/AppRegistry.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMimeDatabase>
+#include <QMimeType>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QWriteLocker>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+// QMimeDatabase never looks further into a file than this when matching magic rules.
+constexpr qint64 SniffBytes = 16384;
+// A directory's records are written out once they reach this size, so huge directories do
+// not hold their whole listing in memory.
+constexpr qsizetype FlushBytes = 64 * 1024;
+
+struct AuditState {
+  const MimeAssociationService *service = nullptr;
+  QThreadPool *pool = nullptr;
+  QFile *out = nullptr;
+  QMutex outMutex;
+
+  QMutex totalsMutex;
+  QHash<QString, quint64> typeCounts;
+
+  QReadWriteLock appLock;
+  QHash<QString, QString> appForType;
+
+  std::atomic<quint64> files{0};
+  std::atomic<quint64> directories{0};
+};
+
+// Matches QMimeDatabase::mimeTypeForFile(), but files whose name alone decides are not opened.
+QMimeType sniff(const QMimeDatabase &db, const QFileInfo &info, QByteArray &buffer) {
+  if (!info.isFile()) {
+    return db.mimeTypeForFile(info);
+  }
+
+  const QString fileName = info.fileName();
+  const QList<QMimeType> byName = db.mimeTypesForFileName(fileName);
+  if (byName.size() == 1) {
+    return byName.first();
+  }
+
+  QFile file(info.filePath());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return byName.isEmpty() ? db.mimeTypeForName("application/octet-stream") : byName.first();
+  }
+
+  buffer.resize(SniffBytes);
+  const qint64 read = std::max<qint64>(file.read(buffer.data(), SniffBytes), 0);
+  return db.mimeTypeForFileNameAndData(fileName,
+                                       QByteArray::fromRawData(buffer.constData(), read));
+}
+
+QString appFor(AuditState &state, const QString &mime) {
+  {
+    QReadLocker locker(&state.appLock);
+    const auto it = state.appForType.constFind(mime);
+    if (it != state.appForType.cend()) {
+      return it.value();
+    }
+  }
+
+  // Racing threads may both resolve a new type; they get the same answer.
+  const QVector<MimeEntry> entries = state.service->resolveEntries(QStringList{mime}, 1);
+  const QString id =
+      entries.isEmpty() ? QString() : MimeAssociationService::effectiveAppFor(entries.first());
+
+  QWriteLocker locker(&state.appLock);
+  state.appForType.insert(mime, id);
+  return id;
+}
+
+// Paths are the only field that can hold separators. Tabs, newlines, carriage returns and
+// backslashes are written as \t, \n, \r and \\, so each record stays one line of four fields.
+QString pathField(const QString &path) {
+  if (!path.contains('\t') && !path.contains('\n') && !path.contains('\r') &&
+      !path.contains('\\')) {
+    return path;
+  }
+
+  QString escaped;
+  escaped.reserve(path.size() + 8);
+  for (const QChar c : path) {
+    if (c == '\t') {
+      escaped += "\\t";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else if (c == '\r') {
+      escaped += "\\r";
+    } else if (c == '\\') {
+      escaped += "\\\\";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+QByteArray idField(const QString &id) {
+  return id.isEmpty() ? QByteArray("-") : id.toUtf8();
+}
+
+void writeRecords(AuditState &state, QByteArray &records) {
+  if (records.isEmpty()) {
+    return;
+  }
+
+  QMutexLocker locker(&state.outMutex);
+  state.out->write(records);
+  state.out->flush();
+  records.clear();
+}
+
+void auditDirectory(AuditState &state, const QString &dir) {
+  state.directories.fetch_add(1, std::memory_order_relaxed);
+
+  QMimeDatabase db;
+  QByteArray buffer;
+  QByteArray records;
+  QHash<QString, quint64> counts;
+
+  // Directory symlinks are classified but not followed, so cycles cannot form.
+  QDirIterator it(dir, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo info = it.fileInfo();
+
+    if (info.isDir() && !info.isSymLink()) {
+      const QString subdir = info.filePath();
+      state.pool->start([&state, subdir]() { auditDirectory(state, subdir); });
+      continue;
+    }
+
+    const QString mime = sniff(db, info, buffer).name();
+    ++counts[mime];
+
+    records += "file\t";
+    records += pathField(info.filePath()).toUtf8();
+    records += '\t';
+    records += mime.toUtf8();
+    records += '\t';
+    records += idField(appFor(state, mime));
+    records += '\n';
+    if (records.size() >= FlushBytes) {
+      writeRecords(state, records);
+    }
+  }
+
+  writeRecords(state, records);
+
+  quint64 files = 0;
+  QMutexLocker locker(&state.totalsMutex);
+  for (auto count = counts.cbegin(); count != counts.cend(); ++count) {
+    state.typeCounts[count.key()] += count.value();
+    files += count.value();
+  }
+  state.files.fetch_add(files, std::memory_order_relaxed);
+}
+
+template <typename Key>
+QVector<QPair<Key, quint64>> byCountDescending(const QHash<Key, quint64> &counts) {
+  QVector<QPair<Key, quint64>> sorted;
+  sorted.reserve(counts.size());
+  for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+    sorted.append(qMakePair(it.key(), it.value()));
+  }
+
+  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  return sorted;
+}
+} // namespace
+
+int DirectoryAudit::which(const XdgEnvironment &env, const QStringList &paths) {
+  AppRegistry registry(env);
+  registry.load();
+  MimeDefaultsStore store(env);
+  store.reload();
+  const MimeAssociationService service(&registry, &store);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+  QMimeDatabase db;
+  int status = 0;
+
+  for (const QString &path : paths) {
+    const QFileInfo info(path);
+    if (!info.exists()) {
+      err << "error: " << pathField(path) << " does not exist\n";
+      status = 1;
+      continue;
+    }
+
+    const QString mime = db.mimeTypeForFile(info).name();
+    const QString id = MimeAssociationService::effectiveAppFor(service.entryFor(mime));
+    out << pathField(path) << '\t' << mime << '\t' << (id.isEmpty() ? QString("-") : id) << '\n';
+  }
+
+  return status;
+}
+
+int DirectoryAudit::run(const XdgEnvironment &env, const QString &root, int jobs) {
+  QTextStream err(stderr);
+
+  if (!QFileInfo(root).isDir()) {
+    err << "error: " << root << " is not a directory\n";
+    return 2;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  AppRegistry registry(env);
+  registry.load();
+  MimeDefaultsStore store(env);
+  store.reload();
+  const MimeAssociationService service(&registry, &store);
+
+  QFile out;
+  if (!out.open(stdout, QIODevice::WriteOnly)) {
+    err << "error: cannot write to standard output\n";
+    return 2;
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(jobs > 0 ? jobs : QThread::idealThreadCount());
+
+  AuditState state;
+  state.service = &service;
+  state.pool = &pool;
+  state.out = &out;
+
+  out.write("# file\tpath\tmime\tdesktop-id\n");
+  const QString start = QDir(root).absolutePath();
+  pool.start([&state, start]() { auditDirectory(state, start); });
+  pool.waitForDone();
+
+  QByteArray totals = "# type\tmime\tcount\tdesktop-id\n";
+  QHash<QString, quint64> appCounts;
+  for (const auto &type : byCountDescending(state.typeCounts)) {
+    const QString id = state.appForType.value(type.first);
+    appCounts[id] += type.second;
+    totals += "type\t" + type.first.toUtf8() + '\t' + QByteArray::number(type.second) + '\t' +
+              idField(id) + '\n';
+  }
+
+  totals += "# app\tdesktop-id\tcount\n";
+  for (const auto &app : byCountDescending(appCounts)) {
+    totals += "app\t" + idField(app.first) + '\t' + QByteArray::number(app.second) + '\n';
+  }
+  out.write(totals);
+  out.flush();
+
+  err << "classified " << state.files.load() << " files in " << state.directories.load()
+      << " directories in " << timer.elapsed() << " ms\n";
+  return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+class XdgEnvironment;
+
+// Answers "which application opens this?" for single paths and for whole directory trees.
+// Trees are walked in parallel, one pool task per directory. A file's content is read only
+// when its name matches no single type, and then only the prefix QMimeDatabase inspects.
+//
+// Audit output is tab-separated, one record per line. File records stream as each directory
+// finishes; totals per type and per application follow once the walk is done:
+//   file <path> <mime> <desktop-id|->
+//   type <mime> <count> <desktop-id|->
+//   app <desktop-id|-> <count>
+// Tabs, newlines, carriage returns and backslashes in paths are escaped as \t, \n, \r and \\.
+class DirectoryAudit {
+public:
+  // Prints <path> <mime> <desktop-id|-> for each path, using QMimeDatabase::mimeTypeForFile;
+  // paths are escaped as in audit records.
+  static int which(const XdgEnvironment &env, const QStringList &paths);
+  static int run(const XdgEnvironment &env, const QString &root, int jobs);
+};
@@ -0,0 +1,191 @@
+#include "cli/HomeAudit.h"
+
+#include "services/AppRegistry.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace {
+QStringList readHomes(const QString &path, QString *error) {
+  QFile file;
+  bool opened = false;
+  if (path == "-") {
+    opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+  } else {
+    file.setFileName(path);
+    opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+  }
+
+  if (!opened) {
+    *error = file.errorString();
+    return {};
+  }
+
+  QStringList homes;
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    const QString line = in.readLine().trimmed();
+
+    if (!line.isEmpty() && !line.startsWith('#')) {
+      homes.append(line);
+    }
+  }
+
+  return homes;
+}
+
+void appendRecord(QByteArray &out, const char *kind, const QString &mime, const QString &id,
+                  const char *layer) {
+  out += kind;
+  out += '\t';
+  out += mime.toUtf8();
+  out += '\t';
+  out += id.toUtf8();
+  out += '\t';
+  out += layer;
+  out += '\n';
+}
+
+void appendBroken(QByteArray &out, const QHash<QString, QStringList> &section, const char *kind,
+                  const char *layer, const AppRegistry &registry) {
+  QStringList keys = section.keys();
+  std::sort(keys.begin(), keys.end());
+
+  for (const QString &mime : keys) {
+    for (const QString &id : section.value(mime)) {
+      if (!registry.findById(id)) {
+        appendRecord(out, kind, mime, id, layer);
+      }
+    }
+  }
+}
+
+// Records without the leading home column: every effective default, then broken user entries.
+QByteArray auditRecords(AppRegistry &registry, MimeDefaultsStore &store) {
+  MimeAssociationService service(&registry, &store);
+  const QHash<QString, QStringList> userDefaults = store.userDefaults();
+  const QHash<QString, QStringList> systemDefaults = store.systemDefaults();
+
+  // Only types named in a Default Applications section can have an effective default.
+  QStringList keys = systemDefaults.keys();
+  for (auto it = userDefaults.cbegin(); it != userDefaults.cend(); ++it) {
+    if (!systemDefaults.contains(it.key())) {
+      keys.append(it.key());
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  QByteArray out;
+  for (const QString &mime : keys) {
+    const QString id = service.defaultFor(mime);
+    if (!id.isEmpty()) {
+      const bool fromUser = !userDefaults.value(mime).isEmpty();
+      appendRecord(out, "default", mime, id, fromUser ? "user" : "system");
+    }
+  }
+
+  appendBroken(out, userDefaults, "broken-default", "user", registry);
+  appendBroken(out, store.userAssociations(), "broken-association", "user", registry);
+  return out;
+}
+
+QByteArray prefixLines(const QString &home, const QByteArray &records) {
+  const QByteArray prefix = home.toUtf8() + '\t';
+  QByteArray out;
+  out.reserve(records.size() + prefix.size() * (records.count('\n') + 1));
+
+  qsizetype start = 0;
+  while (start < records.size()) {
+    qsizetype end = records.indexOf('\n', start);
+    if (end < 0) {
+      end = records.size() - 1;
+    }
+    out += prefix;
+    out += records.mid(start, end - start + 1);
+    start = end + 1;
+  }
+
+  return out;
+}
+} // namespace
+
+int HomeAudit::run(const XdgEnvironment &env, const QString &homesFile, int jobs) {
+  QTextStream err(stderr);
+
+  QString error;
+  const QStringList homes = readHomes(homesFile, &error);
+  if (!error.isEmpty()) {
+    err << "error: cannot read " << homesFile << ": " << error << '\n';
+    return 2;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  AppRegistry systemRegistry(env);
+  systemRegistry.loadSystemLayer();
+  MimeDefaultsStore systemStore(env);
+  systemStore.reloadSystemLayer();
+
+  QFile out;
+  if (!out.open(stdout, QIODevice::WriteOnly)) {
+    err << "error: cannot write to standard output\n";
+    return 2;
+  }
+
+  QByteArray systemBroken;
+  appendBroken(systemBroken, systemStore.systemDefaults(), "broken-default", "system",
+               systemRegistry);
+  appendBroken(systemBroken, systemStore.systemAssociations(), "broken-association", "system",
+               systemRegistry);
+  out.write("# home\tkind\tmime\tdesktop-id\tlayer\n");
+  out.write(prefixLines("-", systemBroken));
+  out.flush();
+
+  // Homes without a user layer all share this report.
+  AppRegistry baselineRegistry = systemRegistry;
+  MimeDefaultsStore baselineStore = systemStore;
+  const QByteArray baseline = auditRecords(baselineRegistry, baselineStore);
+
+  QMutex outMutex;
+  QThreadPool pool;
+  pool.setMaxThreadCount(jobs > 0 ? jobs : QThread::idealThreadCount());
+
+  for (const QString &home : homes) {
+    pool.start([&, home]() {
+      const XdgEnvironment homeEnv = env.withHome(home);
+      QByteArray records;
+
+      if (!QFileInfo::exists(homeEnv.userMimeappsPath()) &&
+          !QFileInfo(homeEnv.userAppDir()).isDir()) {
+        records = baseline;
+      } else {
+        AppRegistry registry = systemRegistry.withUserLayer(homeEnv);
+        MimeDefaultsStore store = systemStore.withUserLayer(homeEnv);
+        records = auditRecords(registry, store);
+      }
+
+      const QByteArray report = prefixLines(home, records);
+      QMutexLocker locker(&outMutex);
+      out.write(report);
+      out.flush();
+    });
+  }
+  pool.waitForDone();
+
+  err << "audited " << homes.size() << " homes in " << timer.elapsed() << " ms\n";
+  return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QString>
+
+class XdgEnvironment;
+
+// Reports the effective defaults and broken entries of many home directories that share one
+// system layer. The system registry and system mimeapps.list files are parsed once; each home
+// only adds its own user layer, and homes are audited in parallel.
+//
+// Output is tab-separated, one record per line, streamed as each home finishes:
+//   <home> default <mime> <desktop-id> <user|system>
+//   <home> broken-default|broken-association <mime> <desktop-id> <user|system>
+// System-layer broken entries are reported once with "-" as the home.
+class HomeAudit {
+public:
+  static int run(const XdgEnvironment &env, const QString &homesFile, int jobs);
+};
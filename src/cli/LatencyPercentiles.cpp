@@ -0,0 +1,22 @@
+#include "cli/LatencyPercentiles.h"
+
+#include <algorithm>
+
+LatencyPercentiles LatencyPercentiles::of(QVector<qint64> samplesNs) {
+  LatencyPercentiles result;
+  if (samplesNs.isEmpty()) {
+    return result;
+  }
+
+  std::sort(samplesNs.begin(), samplesNs.end());
+  const int count = static_cast<int>(samplesNs.size());
+  const auto at = [&samplesNs, count](double fraction) {
+    return samplesNs[std::min(count - 1, static_cast<int>(fraction * count))] / 1000.0;
+  };
+
+  result.p50 = at(0.50);
+  result.p90 = at(0.90);
+  result.p99 = at(0.99);
+  result.max = samplesNs.last() / 1000.0;
+  return result;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+// Percentiles of a benchmark's per-step timings, shared by the benchmark modes so their figures
+// compare. Samples are in nanoseconds, results in microseconds; an empty set reports zeros.
+struct LatencyPercentiles {
+  double p50 = 0.0;
+  double p90 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+
+  static LatencyPercentiles of(QVector<qint64> samplesNs);
+};
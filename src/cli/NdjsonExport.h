@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QString>
+
+class XdgEnvironment;
+
+// Streams the resolved association table as NDJSON, one object per type, while it is being
+// resolved. Types are resolved a bounded slice at a time and written through a fixed buffer,
+// so memory does not grow with the table:
+//   {"home":..,"type":..,"description":..,"default":..|null,
+//    "default_source":"user"|"system"|null,"associations":[..]}
+class NdjsonExport {
+public:
+  // outputPath "-" writes to standard output.
+  static int run(const XdgEnvironment &env, const QString &outputPath, int jobs);
+};
@@ -0,0 +1,99 @@
+#include "cli/QueryClient.h"
+
+#include "cli/LatencyPercentiles.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QMimeDatabase>
+#include <QMimeType>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+constexpr int ConnectTimeoutMs = 1000;
+constexpr int ReplyTimeoutMs = 5000;
+
+bool connectTo(QLocalSocket &socket, const QString &socketName) {
+  socket.connectToServer(socketName);
+  if (socket.waitForConnected(ConnectTimeoutMs)) {
+    return true;
+  }
+
+  QTextStream(stderr) << "error: no daemon on " << socketName << ": " << socket.errorString()
+                      << " (start one with --daemon)" << Qt::endl;
+  return false;
+}
+
+// Sends one line and blocks for its reply, without the trailing newline.
+bool roundTrip(QLocalSocket &socket, const QByteArray &request, QByteArray *reply) {
+  socket.write(request);
+  socket.write("\n", 1);
+  socket.flush();
+
+  while (!socket.canReadLine()) {
+    if (!socket.waitForReadyRead(ReplyTimeoutMs)) {
+      return false;
+    }
+  }
+
+  *reply = socket.readLine().trimmed();
+  return true;
+}
+} // namespace
+
+int QueryClient::run(const QString &socketName, const QString &request) {
+  QLocalSocket socket;
+  if (!connectTo(socket, socketName)) {
+    return 2;
+  }
+
+  QByteArray reply;
+  if (!roundTrip(socket, request.toUtf8(), &reply)) {
+    QTextStream(stderr) << "error: no reply: " << socket.errorString() << Qt::endl;
+    return 2;
+  }
+
+  QTextStream(stdout) << QString::fromUtf8(reply) << Qt::endl;
+  return reply == "ok" || reply.startsWith("ok ") ? 0 : 1;
+}
+
+int QueryClient::benchmark(const QString &socketName, int repeat) {
+  QLocalSocket socket;
+  if (!connectTo(socket, socketName)) {
+    return 2;
+  }
+
+  QVector<QByteArray> requests;
+  const QList<QMimeType> types = QMimeDatabase().allMimeTypes();
+  requests.reserve(types.size());
+  for (const QMimeType &type : types) {
+    requests.append("default " + type.name().toUtf8());
+  }
+
+  QVector<qint64> latencies;
+  latencies.reserve(requests.size() * std::max(repeat, 1));
+  QElapsedTimer timer;
+  QByteArray reply;
+
+  for (int round = 0; round < std::max(repeat, 1); ++round) {
+    for (const QByteArray &request : requests) {
+      timer.start();
+      if (!roundTrip(socket, request, &reply)) {
+        QTextStream(stderr) << "error: no reply to " << request << Qt::endl;
+        return 2;
+      }
+      latencies.append(timer.nsecsElapsed());
+    }
+  }
+
+  const LatencyPercentiles summary = LatencyPercentiles::of(latencies);
+  QTextStream out(stdout);
+  out << "queries: " << latencies.size() << " over " << requests.size() << " types\n";
+  out << "   p50 us     p90 us     p99 us     max us\n";
+  out << QString::asprintf("%9.1f  %9.1f  %9.1f  %9.1f\n", summary.p50, summary.p90, summary.p99,
+                           summary.max);
+  return 0;
+}
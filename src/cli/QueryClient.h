@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QString>
+
+// Tiny client for QueryDaemon, for scripts and for measuring it.
+class QueryClient {
+public:
+  // Sends one request line and prints the reply; exits 0 only for an "ok" reply.
+  static int run(const QString &socketName, const QString &request);
+  // Times "default" round trips over every known type, repeat times, and prints percentiles.
+  static int benchmark(const QString &socketName, int repeat);
+};
@@ -0,0 +1,280 @@
+#include "cli/QueryDaemon.h"
+
+#include "services/MimeDefaultsWatcher.h"
+#include "services/UserDefaultsWriter.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMimeType>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QTimer>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+// Package managers touch many desktop files in a row; reload once they are done.
+constexpr int AppSettleDelayMs = 500;
+
+QByteArray okReply(const QString &value) {
+  return value.isEmpty() ? QByteArray("ok -\n") : "ok " + value.toUtf8() + '\n';
+}
+
+QByteArray errorReply(const char *reason) {
+  return QByteArray("err ") + reason + '\n';
+}
+
+int g_signalPipe[2] = {-1, -1};
+
+void onTerminationSignal(int) {
+  // Only async-signal-safe calls here; the event loop picks the byte up and quits.
+  const char byte = 1;
+  [[maybe_unused]] const ssize_t written = ::write(g_signalPipe[1], &byte, 1);
+}
+
+// Turns SIGTERM and SIGINT into a normal return from exec(), so the daemon is destroyed and the
+// writer flushes edits whose "set" was already acknowledged.
+bool quitOnTerminationSignals(QObject *context) {
+  if (::pipe2(g_signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    return false;
+  }
+
+  auto *notifier = new QSocketNotifier(g_signalPipe[0], QSocketNotifier::Read, context);
+  QObject::connect(notifier, &QSocketNotifier::activated, context, []() {
+    char byte = 0;
+    while (::read(g_signalPipe[0], &byte, 1) > 0) {
+    }
+    QCoreApplication::quit();
+  });
+
+  struct sigaction action = {};
+  action.sa_handler = onTerminationSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  return ::sigaction(SIGTERM, &action, nullptr) == 0 && ::sigaction(SIGINT, &action, nullptr) == 0;
+}
+} // namespace
+
+QueryDaemon::QueryDaemon(const XdgEnvironment &env, QObject *parent)
+    : QObject(parent), m_env(env), m_registry(m_env), m_store(m_env),
+      m_service(&m_registry, &m_store),
+      m_writer(new UserDefaultsWriter(m_store.userMimeappsPath(), this)),
+      m_defaultsWatcher(nullptr), m_appWatcher(new QFileSystemWatcher(this)),
+      m_appSettleTimer(new QTimer(this)), m_server(new QLocalServer(this)) {
+  m_registry.load();
+  m_store.reload();
+  rebuildTable();
+
+  m_defaultsWatcher = new MimeDefaultsWatcher(&m_store, this);
+  connect(m_defaultsWatcher, &MimeDefaultsWatcher::keysChanged, this,
+          &QueryDaemon::onDefaultsChanged);
+  connect(m_writer, &UserDefaultsWriter::committed, this, &QueryDaemon::onDefaultsCommitted);
+
+  m_appSettleTimer->setSingleShot(true);
+  m_appSettleTimer->setInterval(AppSettleDelayMs);
+  connect(m_appWatcher, &QFileSystemWatcher::directoryChanged, m_appSettleTimer,
+          qOverload<>(&QTimer::start));
+  connect(m_appSettleTimer, &QTimer::timeout, this, &QueryDaemon::reloadApps);
+  rewatchApps();
+
+  m_server->setSocketOptions(QLocalServer::UserAccessOption);
+  connect(m_server, &QLocalServer::newConnection, this, &QueryDaemon::onNewConnection);
+}
+
+QString QueryDaemon::defaultSocketName() {
+  return QString("mime-settings-query-%1").arg(::getuid());
+}
+
+int QueryDaemon::run(const XdgEnvironment &env, const QString &socketName) {
+  QTextStream err(stderr);
+  QElapsedTimer timer;
+  timer.start();
+
+  QueryDaemon daemon(env);
+  if (!daemon.listen(socketName)) {
+    err << "error: cannot listen on " << socketName << ": " << daemon.m_server->errorString()
+        << '\n';
+    return 2;
+  }
+
+  if (!quitOnTerminationSignals(&daemon)) {
+    err << "warning: cannot catch SIGTERM/SIGINT; pending edits may be lost on shutdown\n";
+  }
+
+  err << "serving " << daemon.m_entries.size() << " types on "
+      << daemon.m_server->fullServerName() << " (ready in " << timer.elapsed() << " ms)"
+      << Qt::endl;
+  return QCoreApplication::exec();
+}
+
+bool QueryDaemon::listen(const QString &socketName) {
+  if (m_server->listen(socketName)) {
+    return true;
+  }
+
+  // A live daemon answers; only a stale socket file may be taken over.
+  QLocalSocket probe;
+  probe.connectToServer(socketName);
+  if (probe.waitForConnected(200)) {
+    return false;
+  }
+
+  QLocalServer::removeServer(socketName);
+  return m_server->listen(socketName);
+}
+
+void QueryDaemon::rebuildTable() {
+  const QVector<MimeEntry> entries = m_service.buildEntries();
+  m_entries.clear();
+  m_entries.reserve(entries.size());
+  for (const MimeEntry &entry : entries) {
+    m_entries.insert(entry.mimeType, entry);
+  }
+}
+
+void QueryDaemon::reloadApps() {
+  // The set of application directories itself may have changed, e.g. a first user-installed
+  // application creating ~/.local/share/applications.
+  m_env = m_env.withCurrentAppDirs();
+  m_registry = AppRegistry(m_env);
+  m_registry.load();
+  rebuildTable();
+  rewatchApps();
+}
+
+void QueryDaemon::rewatchApps() {
+  const QStringList watched = m_appWatcher->directories();
+  if (!watched.isEmpty()) {
+    m_appWatcher->removePaths(watched);
+  }
+
+  // Desktop IDs may live in subdirectories (kde4/foo.desktop), and inotify only reports
+  // changes one level down, so every directory of the tree is watched.
+  QStringList dirs;
+  const QStringList appDirs = m_env.appDirs();
+  for (const QString &dir : appDirs) {
+    dirs.append(dir);
+    QDirIterator it(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      dirs.append(it.next());
+    }
+  }
+
+  // A data directory without an applications directory yet is watched for its creation.
+  QStringList dataDirs = m_env.dataDirs();
+  dataDirs.prepend(m_env.dataHome());
+  for (const QString &dir : dataDirs) {
+    if (!appDirs.contains(dir + "/applications") && QFileInfo(dir).isDir()) {
+      dirs.append(dir);
+    }
+  }
+
+  dirs.removeDuplicates();
+  if (!dirs.isEmpty()) {
+    m_appWatcher->addPaths(dirs);
+  }
+}
+
+void QueryDaemon::refreshTypes(const QStringList &mimes) {
+  const QVector<MimeEntry> entries = m_service.resolveEntries(mimes);
+  for (const MimeEntry &entry : entries) {
+    m_entries.insert(entry.mimeType, entry);
+  }
+}
+
+void QueryDaemon::onDefaultsChanged(const QSet<QString> &keys) {
+  refreshTypes(m_service.typesAffectedBy(keys));
+}
+
+void QueryDaemon::onDefaultsCommitted(const QVector<QPair<QString, QString>> &edits, bool ok,
+                                      const QString &errorString) {
+  if (!ok) {
+    QTextStream(stderr) << "error: cannot save " << m_store.userMimeappsPath() << ": "
+                        << errorString << Qt::endl;
+  }
+
+  const QSet<QString> reverted = m_store.settleUserDefaults(edits);
+  if (!reverted.isEmpty()) {
+    onDefaultsChanged(reverted);
+  }
+}
+
+void QueryDaemon::onNewConnection() {
+  while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+    connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { serve(socket); });
+  }
+}
+
+void QueryDaemon::serve(QLocalSocket *socket) {
+  // Pipelined requests are answered with a single write.
+  QByteArray replies;
+  while (socket->canReadLine()) {
+    replies += handle(socket->readLine().trimmed());
+  }
+
+  if (!replies.isEmpty()) {
+    socket->write(replies);
+  }
+}
+
+QByteArray QueryDaemon::handle(const QByteArray &line) {
+  const QList<QByteArray> words = line.simplified().split(' ');
+  const QByteArray &command = words.first();
+
+  if (command == "ping" && words.size() == 1) {
+    return "ok\n";
+  }
+
+  if ((command == "default" || command == "apps") && words.size() == 2) {
+    const MimeEntry *entry = entryFor(QString::fromUtf8(words[1]));
+    if (!entry) {
+      return errorReply("unknown type");
+    }
+
+    return okReply(command == "default" ? entry->defaultAppId
+                                        : entry->associatedAppIds.join(';'));
+  }
+
+  if (command == "set" && words.size() == 3) {
+    const MimeEntry *entry = entryFor(QString::fromUtf8(words[1]));
+    const QString desktopId = QString::fromUtf8(words[2]);
+    if (!entry) {
+      return errorReply("unknown type");
+    }
+    if (!m_registry.findById(desktopId)) {
+      return errorReply("unknown application");
+    }
+
+    const QString mime = entry->mimeType;
+    m_service.setDefault(mime, desktopId);
+    m_writer->enqueue(mime, desktopId);
+    refreshTypes(m_service.typesAffectedBy(QSet<QString>{mime}));
+    return "ok\n";
+  }
+
+  return errorReply("bad request");
+}
+
+const MimeEntry *QueryDaemon::entryFor(const QString &mime) {
+  auto it = m_entries.constFind(mime);
+  if (it == m_entries.cend()) {
+    // Aliases and differently cased names resolve to the canonical entry.
+    const QMimeType type = m_db.mimeTypeForName(mime);
+    if (!type.isValid()) {
+      return nullptr;
+    }
+    it = m_entries.constFind(type.name());
+  }
+
+  return it == m_entries.cend() ? nullptr : &it.value();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "services/AppRegistry.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMimeDatabase>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class MimeDefaultsWatcher;
+class QFileSystemWatcher;
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+class UserDefaultsWriter;
+
+// Resident answerer for scripts that would otherwise start a process per question. Keeps the
+// registry, the store and the resolved table in memory, follows file changes the same way the
+// window does, and serves a line protocol on a local socket. Each request is one UTF-8 line
+// and gets one reply line, in order:
+//   ping                      ok
+//   default <mime>            ok <desktop-id|->
+//   apps <mime>               ok <desktop-id>;<desktop-id>;...
+//   set <mime> <desktop-id>   ok            (written behind, as in the window)
+// Failures reply "err <reason>".
+class QueryDaemon : public QObject {
+  Q_OBJECT
+
+public:
+  explicit QueryDaemon(const XdgEnvironment &env, QObject *parent = nullptr);
+
+  static QString defaultSocketName();
+  // Serves until SIGTERM or SIGINT, then flushes pending edits and returns.
+  static int run(const XdgEnvironment &env, const QString &socketName);
+
+private:
+  bool listen(const QString &socketName);
+  void rebuildTable();
+  void reloadApps();
+  void rewatchApps();
+  void refreshTypes(const QStringList &mimes);
+  void onDefaultsChanged(const QSet<QString> &keys);
+  void onDefaultsCommitted(const QVector<QPair<QString, QString>> &edits, bool ok,
+                           const QString &errorString);
+  void onNewConnection();
+  void serve(QLocalSocket *socket);
+  QByteArray handle(const QByteArray &line);
+  const MimeEntry *entryFor(const QString &mime);
+
+  XdgEnvironment m_env;
+  AppRegistry m_registry;
+  MimeDefaultsStore m_store;
+  MimeAssociationService m_service;
+  QHash<QString, MimeEntry> m_entries;
+  QMimeDatabase m_db;
+
+  UserDefaultsWriter *m_writer;
+  MimeDefaultsWatcher *m_defaultsWatcher;
+  QFileSystemWatcher *m_appWatcher;
+  QTimer *m_appSettleTimer;
+  QLocalServer *m_server;
+};
@@ -0,0 +1,80 @@
+#include "cli/ResolveBenchmark.h"
+
+#include "services/AppRegistry.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+bool sameEntries(const QVector<MimeEntry> &a, const QVector<MimeEntry> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (int i = 0; i < a.size(); ++i) {
+    if (a[i].mimeType != b[i].mimeType || a[i].defaultAppId != b[i].defaultAppId ||
+        a[i].associatedAppIds != b[i].associatedAppIds ||
+        a[i].preferredAppIds != b[i].preferredAppIds) {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+int ResolveBenchmark::run(const XdgEnvironment &env, int repeat) {
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+  repeat = std::max(1, repeat);
+
+  AppRegistry registry(env);
+  registry.load();
+  MimeDefaultsStore store(env);
+  store.reload();
+  MimeAssociationService service(&registry, &store);
+
+  const QVector<MimeEntry> reference = service.buildEntries(1);
+  out << "types: " << reference.size() << ", ideal threads: " << QThread::idealThreadCount()
+      << ", runs per row: " << repeat << '\n';
+  out << "threads   median ms   speedup\n";
+
+  double baseline = 0.0;
+  bool mismatch = false;
+  for (int threads : {1, 2, 4, 8, 16}) {
+    QVector<double> samples;
+    for (int i = 0; i < repeat; ++i) {
+      QElapsedTimer timer;
+      timer.start();
+      const QVector<MimeEntry> entries = service.buildEntries(threads);
+      samples.append(timer.nsecsElapsed() / 1e6);
+
+      if (!sameEntries(entries, reference)) {
+        mismatch = true;
+      }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const double median = samples[samples.size() / 2];
+    if (threads == 1) {
+      baseline = median;
+    }
+
+    out << QString::asprintf("%7d   %9.2f   %6.2fx\n", threads, median,
+                             median > 0.0 ? baseline / median : 0.0);
+  }
+
+  if (mismatch) {
+    err << "error: a parallel build differed from the serial build\n";
+    return 1;
+  }
+
+  return 0;
+}
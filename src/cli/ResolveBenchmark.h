@@ -0,0 +1,10 @@
+#pragma once
+
+class XdgEnvironment;
+
+// Times MimeAssociationService::buildEntries() across thread counts and checks that every
+// parallel build matches the serial one entry for entry.
+class ResolveBenchmark {
+public:
+  static int run(const XdgEnvironment &env, int repeat);
+};
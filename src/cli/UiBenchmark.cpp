@@ -0,0 +1,266 @@
+#include "cli/UiBenchmark.h"
+
+#include "cli/LatencyPercentiles.h"
+#include "ui/MainWindow.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QComboBox>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QMimeDatabase>
+#include <QRandomGenerator>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTreeView>
+
+#include <functional>
+
+namespace {
+constexpr int SyntheticAppCount = 600;
+constexpr int MaxTypesPerApp = 40;
+constexpr int SyntheticUserDefaults = 400;
+constexpr int SyntheticSystemDefaults = 300;
+constexpr int MaxScrollSteps = 200;
+constexpr int NavigationSteps = 200;
+// Lets the idle work queued at startup (snapshot write, description fill) finish first.
+constexpr int WarmUpPasses = 200;
+
+struct StepTiming {
+  qint64 handleNs;
+  qint64 layoutNs;
+  qint64 paintNs;
+  qint64 latencyNs;
+};
+
+class Recorder {
+public:
+  explicit Recorder(QWidget *window) : m_window(window) {
+  }
+
+  // Delivers one input synchronously, then lays out, paints a full frame and drains whatever
+  // the step queued, timing each stage.
+  void step(const std::function<void()> &input) {
+    QElapsedTimer timer;
+    timer.start();
+    input();
+    const qint64 handled = timer.nsecsElapsed();
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::LayoutRequest);
+    const qint64 laidOut = timer.nsecsElapsed();
+    m_window->repaint();
+    const qint64 painted = timer.nsecsElapsed();
+    QCoreApplication::processEvents();
+
+    m_steps.append(StepTiming{handled, laidOut - handled, painted - laidOut, timer.nsecsElapsed()});
+  }
+
+  QJsonObject finish(const QString &name) {
+    QJsonObject scenario;
+    scenario["name"] = name;
+    scenario["steps"] = static_cast<int>(m_steps.size());
+    scenario["handle_us"] = percentiles(&StepTiming::handleNs);
+    scenario["layout_us"] = percentiles(&StepTiming::layoutNs);
+    scenario["paint_us"] = percentiles(&StepTiming::paintNs);
+    scenario["latency_us"] = percentiles(&StepTiming::latencyNs);
+    m_steps.clear();
+    return scenario;
+  }
+
+private:
+  QJsonObject percentiles(qint64 StepTiming::*field) const {
+    QVector<qint64> values;
+    values.reserve(m_steps.size());
+    for (const StepTiming &step : m_steps) {
+      values.append(step.*field);
+    }
+
+    const LatencyPercentiles summary = LatencyPercentiles::of(values);
+    QJsonObject result;
+    result["p50"] = summary.p50;
+    result["p90"] = summary.p90;
+    result["p99"] = summary.p99;
+    result["max"] = summary.max;
+    return result;
+  }
+
+  QWidget *m_window;
+  QVector<StepTiming> m_steps;
+};
+
+void sendKey(QWidget *target, int key, const QString &text = QString()) {
+  QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, text);
+  QCoreApplication::sendEvent(target, &press);
+  QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, text);
+  QCoreApplication::sendEvent(target, &release);
+}
+
+bool writeFile(const QString &path, const QString &contents) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return false;
+  }
+
+  file.write(contents.toUtf8());
+  return true;
+}
+
+QString defaultsSection(const QStringList &types, int count, int appCount,
+                        QRandomGenerator &random) {
+  QString text = "[Default Applications]\n";
+  for (int i = 0; i < count; ++i) {
+    text += QString("%1=bench-app-%2.desktop;\n")
+                .arg(types[random.bounded(static_cast<int>(types.size()))])
+                .arg(random.bounded(appCount), 3, 10, QChar('0'));
+  }
+
+  return text;
+}
+
+// Applications declaring random slices of the real MIME database, plus system and user lists.
+// Seeded, so every run sees the same tree.
+bool writeSyntheticTree(const QString &root, const QString &home) {
+  QRandomGenerator random(42);
+
+  QStringList types;
+  const QList<QMimeType> all = QMimeDatabase().allMimeTypes();
+  for (const QMimeType &type : all) {
+    types.append(type.name());
+  }
+  if (types.isEmpty()) {
+    return false;
+  }
+
+  const QString appDir = root + "/usr/share/applications";
+  for (int i = 0; i < SyntheticAppCount; ++i) {
+    QStringList declared;
+    const int count = 1 + random.bounded(MaxTypesPerApp);
+    for (int j = 0; j < count; ++j) {
+      declared.append(types[random.bounded(static_cast<int>(types.size()))]);
+    }
+
+    const QString name = QString("bench-app-%1").arg(i, 3, 10, QChar('0'));
+    const QString desktop = QString("[Desktop Entry]\nType=Application\nName=Bench App %1\n"
+                                    "Exec=%2 %U\nMimeType=%3;\n")
+                                .arg(i)
+                                .arg(name, declared.join(';'));
+    if (!writeFile(appDir + "/" + name + ".desktop", desktop)) {
+      return false;
+    }
+  }
+
+  QDir().mkpath(root + "/etc/xdg");
+  return writeFile(appDir + "/mimeapps.list",
+                   defaultsSection(types, SyntheticSystemDefaults, SyntheticAppCount, random)) &&
+         writeFile(home + "/.config/mimeapps.list",
+                   defaultsSection(types, SyntheticUserDefaults, SyntheticAppCount, random));
+}
+} // namespace
+
+int UiBenchmark::run(const QString &rootPrefix, const QString &reportPath) {
+  QTextStream err(stderr);
+
+  QTemporaryDir syntheticRoot;
+  QString root = rootPrefix;
+  if (root.isEmpty()) {
+    if (!syntheticRoot.isValid()) {
+      err << "error: cannot create a temporary directory\n";
+      return 1;
+    }
+
+    root = syntheticRoot.path();
+    if (!writeSyntheticTree(root, root + QDir::homePath())) {
+      err << "error: cannot write the synthetic tree under " << root << '\n';
+      return 1;
+    }
+  }
+
+  MainWindow window(XdgEnvironment::fromProcess(root));
+  window.resize(1100, 720);
+  window.show();
+  for (int i = 0; i < WarmUpPasses; ++i) {
+    QCoreApplication::processEvents();
+  }
+
+  auto *search = window.findChild<QLineEdit *>("SearchField");
+  auto *table = window.findChild<QTreeView *>("MimeTable");
+  auto *themePicker = window.findChild<QComboBox *>("ThemePicker");
+  auto *accentPicker = window.findChild<QComboBox *>("AccentPicker");
+  if (!search || !table || !themePicker || !accentPicker) {
+    err << "error: the main window is missing a widget the scenarios drive\n";
+    return 1;
+  }
+
+  Recorder recorder(&window);
+  QJsonArray scenarios;
+
+  const QString query = "application/x";
+  for (const QChar c : query) {
+    recorder.step([&]() { sendKey(search, c.toUpper().unicode(), QString(c)); });
+  }
+  recorder.step([&]() { search->clear(); });
+  scenarios.append(recorder.finish("type-search"));
+
+  recorder.step([&]() { table->expandAll(); });
+  scenarios.append(recorder.finish("expand-all"));
+
+  table->setCurrentIndex(table->model()->index(0, 0));
+  table->scrollToTop();
+  for (int i = 0; i < MaxScrollSteps; ++i) {
+    if (table->verticalScrollBar()->value() >= table->verticalScrollBar()->maximum()) {
+      break;
+    }
+    recorder.step([&]() { sendKey(table, Qt::Key_PageDown); });
+  }
+  scenarios.append(recorder.finish("page-scroll"));
+
+  table->setCurrentIndex(table->model()->index(0, 0));
+  table->scrollToTop();
+  for (int i = 0; i < NavigationSteps; ++i) {
+    recorder.step([&]() { sendKey(table, Qt::Key_Down); });
+  }
+  scenarios.append(recorder.finish("arrow-navigation"));
+
+  const int originalTheme = themePicker->currentIndex();
+  for (int i = 0; i < themePicker->count(); ++i) {
+    recorder.step([&]() { themePicker->setCurrentIndex(i); });
+  }
+  recorder.step([&]() { themePicker->setCurrentIndex(originalTheme); });
+  scenarios.append(recorder.finish("theme-switch"));
+
+  // Kept apart from theme-switch: an accent change re-polishes only the accent targets, a theme
+  // change the whole window, and mixing the two hides which path got slower.
+  const int originalAccent = accentPicker->currentIndex();
+  for (int i = 0; i < accentPicker->count(); ++i) {
+    recorder.step([&]() { accentPicker->setCurrentIndex(i); });
+  }
+  recorder.step([&]() { accentPicker->setCurrentIndex(originalAccent); });
+  scenarios.append(recorder.finish("accent-switch"));
+
+  QJsonObject report;
+  report["platform"] = QGuiApplication::platformName();
+  report["root"] = rootPrefix.isEmpty() ? QString("synthetic") : rootPrefix;
+  report["scenarios"] = scenarios;
+  const QByteArray json = QJsonDocument(report).toJson();
+
+  if (reportPath.isEmpty() || reportPath == "-") {
+    QTextStream(stdout) << json;
+    return 0;
+  }
+
+  QFile file(reportPath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+    err << "error: cannot write " << reportPath << '\n';
+    return 1;
+  }
+
+  return 0;
+}
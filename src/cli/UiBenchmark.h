@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QString>
+
+// Drives a real MainWindow on the offscreen platform through scripted scenarios: typing into
+// the search field, expanding every category, page-scrolling the tree, arrow-key navigation
+// (which refreshes the details pane), theme switches and accent switches. Each step records
+// input handling, layout, paint and input-to-idle latency; the report is JSON with per-scenario
+// percentiles.
+//
+// Without a root prefix a synthetic system and home are generated in a temporary directory.
+class UiBenchmark {
+public:
+  static int run(const QString &rootPrefix, const QString &reportPath);
+};
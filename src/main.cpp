@@ -1,18 +1,56 @@
+#include "cli/CommandLine.h"
 #include "ui/MainWindow.h"
+#include "utils/SingleInstance.h"
+#include "utils/XdgEnvironment.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QFont>
 
 int main(int argc, char *argv[]) {
+  // Offscreen first: a headless flag such as --stats may accompany an offscreen mode.
+  if (CommandLine::isOffscreen(argc, argv)) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    return CommandLine::run(app.arguments());
+  }
+
+  if (CommandLine::isHeadless(argc, argv)) {
+    QCoreApplication app(argc, argv);
+    return CommandLine::run(app.arguments());
+  }
+
   QApplication app(argc, argv);
 
+  // A window is already up: hand it our arguments and skip the whole cold start.
+  const CommandLine::WindowOptions options = CommandLine::windowOptions(app.arguments());
+  const QString serverName = SingleInstance::defaultServerName();
+  if (!options.newInstance && SingleInstance::forward(serverName, app.arguments())) {
+    return 0;
+  }
+
+  // Claim the socket before the cold start, so launches made while the window is being built
+  // queue up on it instead of starting windows of their own. They are served once exec() runs.
+  SingleInstance instance(serverName);
+  if (!options.newInstance && !instance.listen() &&
+      SingleInstance::forward(serverName, app.arguments())) {
+    return 0;
+  }
+
   QFont font("Noto Sans");
   if (!font.family().isEmpty()) {
     app.setFont(font);
   }
 
-  MainWindow window;
-  window.show();
+  MainWindow window(XdgEnvironment::fromProcess());
+  window.bringToFront(options.selectMime);
+
+  if (!options.newInstance) {
+    QObject::connect(&instance, &SingleInstance::argumentsReceived, &window,
+                     [&window](const QStringList &arguments) {
+                       window.bringToFront(CommandLine::windowOptions(arguments).selectMime);
+                     });
+  }
 
   return app.exec();
 }
@@ -10,6 +10,7 @@ public:
   explicit MimeTypeFilterProxy(QObject *parent = nullptr);
 
   void setFilterText(const QString &text);
+  QString filterText() const;
 
 protected:
   bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
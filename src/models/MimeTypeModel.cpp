@@ -1,14 +1,28 @@
 #include "models/MimeTypeModel.h"
 
 #include "services/AppRegistry.h"
+#include "services/EntrySnapshot.h"
+#include "utils/AllocationStats.h"
+#include "utils/RuntimeCounters.h"
 
 #include <QFont>
 #include <QStringList>
+#include <QTimer>
 
 #include <algorithm>
 
-MimeTypeModel::MimeTypeModel(AppRegistry *registry, QObject *parent)
-    : QAbstractItemModel(parent), m_registry(registry) {
+namespace {
+// Descriptions resolved per idle tick while filling the memo in the background.
+constexpr int DescriptionBatchSize = 64;
+} // namespace
+
+MimeTypeModel::MimeTypeModel(AppRegistry *registry, MimeAssociationService *service,
+                             QObject *parent)
+    : QAbstractItemModel(parent), m_registry(registry), m_service(service),
+      m_descriptionTimer(new QTimer(this)) {
+  m_descriptionTimer->setInterval(0);
+  connect(m_descriptionTimer, &QTimer::timeout, this,
+          &MimeTypeModel::resolvePendingDescriptions);
 }
 
 int MimeTypeModel::rowCount(const QModelIndex &parent) const {
@@ -118,8 +132,10 @@ QVariant MimeTypeModel::data(const QModelIndex &index, int role) const {
       const QString name = m_registry->appDisplayName(entry.defaultAppId);
       return name.isEmpty() ? entry.defaultAppId : name;
     }
-    case DescriptionColumn:
-      return entry.description.isEmpty() ? QString("-") : entry.description;
+    case DescriptionColumn: {
+      const QString description = descriptionFor(entry.mimeType);
+      return description.isEmpty() ? QString("-") : description;
+    }
     default:
       break;
     }
@@ -150,19 +166,47 @@ QVariant MimeTypeModel::headerData(int section, Qt::Orientation orientation, int
   }
 }
 
-void MimeTypeModel::setEntries(const QVector<MimeEntry> &entries) {
+bool MimeTypeModel::hasChildren(const QModelIndex &parent) const {
+  if (!parent.isValid()) {
+    return !m_categories.isEmpty();
+  }
+
+  if (!isCategoryIndex(parent) || parent.column() != 0) {
+    return false;
+  }
+
+  const int categoryIndex = parent.row();
+  return categoryIndex >= 0 && categoryIndex < m_categories.size() &&
+         !m_categories[categoryIndex].mimeTypes.isEmpty();
+}
+
+bool MimeTypeModel::canFetchMore(const QModelIndex &parent) const {
+  if (!isCategoryIndex(parent) || parent.column() != 0) {
+    return false;
+  }
+
+  const int categoryIndex = parent.row();
+  return categoryIndex >= 0 && categoryIndex < m_categories.size() &&
+         !m_categories[categoryIndex].fetched;
+}
+
+void MimeTypeModel::fetchMore(const QModelIndex &parent) {
+  if (canFetchMore(parent)) {
+    fetchCategory(parent.row());
+  }
+}
+
+void MimeTypeModel::setMimeTypes(const QStringList &mimeTypes) {
+  ALLOCATION_PHASE("MimeTypeModel::setMimeTypes");
+  RuntimeCounters::add(RuntimeCounters::ModelResets);
   beginResetModel();
+  m_snapshot.reset();
   m_categories.clear();
-  m_lookup.clear();
 
-  QHash<QString, QVector<MimeEntry>> grouped;
+  QHash<QString, QStringList> grouped;
 
-  for (const MimeEntry &entry : entries) {
-    QString category = entry.mimeType.section('/', 0, 0);
-    if (category.isEmpty()) {
-      category = QString("other");
-    }
-    grouped[category].append(entry);
+  for (const QString &mime : mimeTypes) {
+    grouped[MimeAssociationService::categoryFor(mime)].append(mime);
   }
 
   QStringList categories = grouped.keys();
@@ -173,17 +217,135 @@ void MimeTypeModel::setEntries(const QVector<MimeEntry> &entries) {
   for (const QString &category : categories) {
     CategoryNode node;
     node.name = category;
-    node.entries = grouped.value(category);
+    node.mimeTypes = grouped.value(category);
     m_categories.append(node);
   }
 
-  for (int i = 0; i < m_categories.size(); ++i) {
-    const auto &entriesInCategory = m_categories[i].entries;
-    for (int j = 0; j < entriesInCategory.size(); ++j) {
-      m_lookup.insert(entriesInCategory[j].mimeType, QPair<int, int>(i, j));
+  rebuildLookup();
+  endResetModel();
+
+  queueDescriptions(mimeTypes);
+}
+
+void MimeTypeModel::setSnapshot(std::shared_ptr<const EntrySnapshot> snapshot) {
+  ALLOCATION_PHASE("MimeTypeModel::setSnapshot");
+  RuntimeCounters::add(RuntimeCounters::ModelResets);
+  beginResetModel();
+  m_snapshot = std::move(snapshot);
+  m_categories.clear();
+
+  QStringList mimeTypes;
+  const int categoryCount = m_snapshot ? m_snapshot->categoryCount() : 0;
+  for (int i = 0; i < categoryCount; ++i) {
+    CategoryNode node;
+    node.name = m_snapshot->categoryName(i).toString();
+    node.snapshotCategory = i;
+
+    const int count = m_snapshot->entryCount(i);
+    node.mimeTypes.reserve(count);
+    for (int row = 0; row < count; ++row) {
+      node.mimeTypes.append(m_snapshot->mimeType(i, row).toString());
     }
+
+    mimeTypes.append(node.mimeTypes);
+    m_categories.append(node);
   }
+
+  rebuildLookup();
   endResetModel();
+
+  queueDescriptions(mimeTypes);
+}
+
+void MimeTypeModel::rebuildLookup() {
+  m_lookup.clear();
+  for (int i = 0; i < m_categories.size(); ++i) {
+    const QStringList &typesInCategory = m_categories[i].mimeTypes;
+    for (int j = 0; j < typesInCategory.size(); ++j) {
+      m_lookup.insert(typesInCategory[j], QPair<int, int>(i, j));
+    }
+  }
+}
+
+void MimeTypeModel::queueDescriptions(const QStringList &mimeTypes) {
+  m_pendingDescriptions.clear();
+  m_pendingCursor = 0;
+  for (const QString &mime : mimeTypes) {
+    if (!m_descriptions.contains(mime)) {
+      m_pendingDescriptions.append(mime);
+    }
+  }
+
+  if (m_pendingDescriptions.isEmpty()) {
+    m_descriptionTimer->stop();
+  } else {
+    m_descriptionTimer->start();
+  }
+}
+
+void MimeTypeModel::fetchAll() {
+  // Resolve every pending category in one parallel pass, then hand out the slices.
+  QStringList pending;
+  for (const CategoryNode &node : m_categories) {
+    if (!node.fetched && node.snapshotCategory < 0) {
+      pending.append(node.mimeTypes);
+    }
+  }
+
+  const QVector<MimeEntry> resolved = m_service->resolveEntries(pending);
+  int offset = 0;
+  for (int i = 0; i < m_categories.size(); ++i) {
+    CategoryNode &node = m_categories[i];
+    if (node.fetched) {
+      continue;
+    }
+
+    node.fetched = true;
+    const int count = static_cast<int>(node.mimeTypes.size());
+    if (count == 0) {
+      continue;
+    }
+
+    beginInsertRows(createIndex(i, 0, static_cast<quintptr>(0)), 0, count - 1);
+    if (node.snapshotCategory >= 0) {
+      node.entries = snapshotEntries(node);
+    } else {
+      node.entries = resolved.mid(offset, count);
+      offset += count;
+    }
+    endInsertRows();
+  }
+}
+
+void MimeTypeModel::refreshEntries(const QStringList &mimeTypes) {
+  QStringList live;
+  QVector<QPair<int, int>> locations;
+
+  for (const QString &mime : mimeTypes) {
+    const auto it = m_lookup.constFind(mime);
+    if (it == m_lookup.constEnd()) {
+      continue;
+    }
+
+    CategoryNode &node = m_categories[it.value().first];
+    if (!node.fetched) {
+      node.snapshotCategory = -1;
+      continue;
+    }
+
+    live.append(mime);
+    locations.append(it.value());
+  }
+
+  const QVector<MimeEntry> entries = m_service->resolveEntries(live);
+  for (int i = 0; i < entries.size(); ++i) {
+    const QPair<int, int> loc = locations[i];
+    m_categories[loc.first].entries[loc.second] = entries[i];
+
+    const quintptr parentId = static_cast<quintptr>(loc.first + 1);
+    emit dataChanged(createIndex(loc.second, 0, parentId),
+                     createIndex(loc.second, ColumnCount - 1, parentId));
+  }
 }
 
 MimeEntry MimeTypeModel::entryForIndex(const QModelIndex &index) const {
@@ -201,10 +363,12 @@ MimeEntry MimeTypeModel::entryForIndex(const QModelIndex &index) const {
     return MimeEntry{};
   }
 
-  return entries[index.row()];
+  MimeEntry entry = entries[index.row()];
+  entry.description = descriptionFor(entry.mimeType);
+  return entry;
 }
 
-QModelIndex MimeTypeModel::indexForMime(const QString &mime) const {
+QModelIndex MimeTypeModel::indexForMime(const QString &mime) {
   const auto it = m_lookup.constFind(mime);
   if (it == m_lookup.constEnd()) {
     return QModelIndex();
@@ -215,6 +379,10 @@ QModelIndex MimeTypeModel::indexForMime(const QString &mime) const {
     return QModelIndex();
   }
 
+  if (!m_categories[loc.first].fetched) {
+    fetchCategory(loc.first);
+  }
+
   const auto &entries = m_categories[loc.first].entries;
   if (loc.second < 0 || loc.second >= entries.size()) {
     return QModelIndex();
@@ -226,3 +394,57 @@ QModelIndex MimeTypeModel::indexForMime(const QString &mime) const {
 bool MimeTypeModel::isCategoryIndex(const QModelIndex &index) const {
   return index.isValid() && index.internalId() == 0;
 }
+
+void MimeTypeModel::fetchCategory(int categoryIndex) {
+  CategoryNode &node = m_categories[categoryIndex];
+  if (node.fetched) {
+    return;
+  }
+
+  node.fetched = true;
+  if (node.mimeTypes.isEmpty()) {
+    return;
+  }
+
+  const QVector<MimeEntry> entries = node.snapshotCategory >= 0
+                                         ? snapshotEntries(node)
+                                         : m_service->resolveEntries(node.mimeTypes);
+  const QModelIndex parent = createIndex(categoryIndex, 0, static_cast<quintptr>(0));
+  beginInsertRows(parent, 0, static_cast<int>(entries.size()) - 1);
+  node.entries = entries;
+  endInsertRows();
+}
+
+QVector<MimeEntry> MimeTypeModel::snapshotEntries(const CategoryNode &node) const {
+  QVector<MimeEntry> entries;
+  const int count = m_snapshot->entryCount(node.snapshotCategory);
+  entries.reserve(count);
+  for (int row = 0; row < count; ++row) {
+    entries.append(m_snapshot->entry(node.snapshotCategory, row));
+  }
+
+  return entries;
+}
+
+QString MimeTypeModel::descriptionFor(const QString &mime) const {
+  auto it = m_descriptions.constFind(mime);
+  if (it == m_descriptions.constEnd()) {
+    it = m_descriptions.insert(mime, m_service->descriptionFor(mime));
+  }
+
+  return it.value();
+}
+
+void MimeTypeModel::resolvePendingDescriptions() {
+  const int end = std::min(m_pendingCursor + DescriptionBatchSize,
+                           static_cast<int>(m_pendingDescriptions.size()));
+  for (; m_pendingCursor < end; ++m_pendingCursor) {
+    descriptionFor(m_pendingDescriptions[m_pendingCursor]);
+  }
+
+  if (m_pendingCursor >= m_pendingDescriptions.size()) {
+    m_descriptionTimer->stop();
+    m_pendingDescriptions.clear();
+    m_pendingCursor = 0;
+  }
+}
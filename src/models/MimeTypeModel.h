@@ -6,10 +6,15 @@
 #include <QHash>
 #include <QPair>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QVector>
 
+#include <memory>
+
 class AppRegistry;
+class EntrySnapshot;
+class QTimer;
 
 class MimeTypeModel : public QAbstractItemModel {
   Q_OBJECT
@@ -17,7 +22,7 @@ class MimeTypeModel : public QAbstractItemModel {
 public:
   enum Column { MimeColumn = 0, DefaultAppColumn = 1, DescriptionColumn = 2, ColumnCount = 3 };
 
-  explicit MimeTypeModel(AppRegistry *registry, QObject *parent = nullptr);
+  MimeTypeModel(AppRegistry *registry, MimeAssociationService *service, QObject *parent = nullptr);
 
   int rowCount(const QModelIndex &parent = QModelIndex()) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -25,20 +30,45 @@ public:
   QModelIndex parent(const QModelIndex &child) const override;
   QVariant data(const QModelIndex &index, int role) const override;
   QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
 
-  void setEntries(const QVector<MimeEntry> &entries);
+  void setMimeTypes(const QStringList &mimeTypes);
+  // Lists the snapshot's categories and reads entries from it instead of resolving them.
+  void setSnapshot(std::shared_ptr<const EntrySnapshot> snapshot);
+  void fetchAll();
+  // Re-resolves these types in place; categories not fetched yet resolve them when they are.
+  void refreshEntries(const QStringList &mimeTypes);
   MimeEntry entryForIndex(const QModelIndex &index) const;
-  QModelIndex indexForMime(const QString &mime) const;
+  QModelIndex indexForMime(const QString &mime);
 
 private:
+  // Categories only know their type names until they are expanded, searched or selected;
+  // entries holds the resolved children from then on.
   struct CategoryNode {
     QString name;
+    QStringList mimeTypes;
     QVector<MimeEntry> entries;
+    int snapshotCategory = -1;
+    bool fetched = false;
   };
 
   bool isCategoryIndex(const QModelIndex &index) const;
+  void fetchCategory(int categoryIndex);
+  void rebuildLookup();
+  void queueDescriptions(const QStringList &mimeTypes);
+  QVector<MimeEntry> snapshotEntries(const CategoryNode &node) const;
+  QString descriptionFor(const QString &mime) const;
+  void resolvePendingDescriptions();
 
   AppRegistry *m_registry;
+  MimeAssociationService *m_service;
+  std::shared_ptr<const EntrySnapshot> m_snapshot;
   QVector<CategoryNode> m_categories;
   QHash<QString, QPair<int, int>> m_lookup;
+  mutable QHash<QString, QString> m_descriptions;
+  QStringList m_pendingDescriptions;
+  int m_pendingCursor = 0;
+  QTimer *m_descriptionTimer;
 };
@@ -1,11 +1,15 @@
 #include "services/AppRegistry.h"
 
-#include "utils/XdgPaths.h"
+#include "services/ExecutableIndex.h"
+#include "utils/AllocationStats.h"
+#include "utils/RuntimeCounters.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QSettings>
 #include <QTextStream>
 
@@ -62,37 +66,197 @@ QStringList parseMimeTypesFromDesktopFile(const QString &filePath) {
 
   return {};
 }
+
+// Reads the [MIME Cache] section update-desktop-database writes next to the desktop files.
+bool parseMimeinfoCache(const QString &filePath, QHash<QString, QStringList> &result) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return false;
+  }
+
+  QTextStream in(&file);
+  bool inSection = false;
+  while (!in.atEnd()) {
+    const QString line = in.readLine();
+    const QString trimmed = line.trimmed();
+
+    if (trimmed.isEmpty() || trimmed.startsWith('#')) {
+      continue;
+    }
+
+    if (trimmed.startsWith('[') && trimmed.endsWith(']')) {
+      inSection = (trimmed.compare("[MIME Cache]", Qt::CaseInsensitive) == 0);
+      continue;
+    }
+
+    if (!inSection) {
+      continue;
+    }
+
+    const int eq = trimmed.indexOf('=');
+    if (eq <= 0) {
+      continue;
+    }
+
+    const QString mime = trimmed.left(eq).trimmed();
+    const QStringList ids = trimmed.mid(eq + 1).split(';', Qt::SkipEmptyParts);
+    QStringList &list = result[mime];
+    for (const QString &id : ids) {
+      const QString part = id.trimmed();
+
+      if (!part.isEmpty()) {
+        list.append(part);
+      }
+    }
+  }
+
+  return true;
+}
+
+// Fills everything but the ID and path. The MIME types are read even for entries that turn
+// out to be unusable, so a shadowed entry's cache rows can still be found and dropped.
+bool parseDesktopFile(AppInfo &app, const ExecutableIndex *executables) {
+  RuntimeCounters::add(RuntimeCounters::DesktopFilesParsed);
+  app.mimeTypes = parseMimeTypesFromDesktopFile(app.desktopPath);
+
+  QSettings settings(app.desktopPath, QSettings::IniFormat);
+  settings.beginGroup("Desktop Entry");
+
+  if (app.mimeTypes.isEmpty()) {
+    const QString mimeValue = settings.value("MimeType").toString();
+    const QStringList mimeParts = mimeValue.split(';', Qt::SkipEmptyParts);
+    for (const QString &part : mimeParts) {
+      const QString trimmed = part.trimmed();
+
+      if (!trimmed.isEmpty()) {
+        app.mimeTypes.append(trimmed);
+      }
+    }
+  }
+
+  const QString type = settings.value("Type").toString().trimmed();
+  if (!type.isEmpty() && type.compare("Application", Qt::CaseInsensitive) != 0) {
+    return false;
+  }
+
+  // Hidden means deleted, and a user copy with it masks the system entry. NoDisplay only keeps
+  // the entry out of menus: it still handles its MIME types, so a user copy that hides an
+  // application from menus must not take it away as a handler.
+  if (settings.value("Hidden", false).toBool()) {
+    return false;
+  }
+
+  // An entry whose TryExec binary is gone is not installed, whatever its desktop file says.
+  const QString tryExec = settings.value("TryExec").toString().trimmed();
+  if (!tryExec.isEmpty() && executables && !executables->canRun(tryExec)) {
+    return false;
+  }
+
+  app.name = settings.value("Name").toString().trimmed();
+  app.exec = settings.value("Exec").toString().trimmed();
+  app.iconName = settings.value("Icon").toString().trimmed();
+
+  if (app.name.isEmpty()) {
+    app.name = app.desktopId;
+  }
+
+  return true;
+}
+
+// Desktop IDs flatten subdirectories into dashes, so "kde4-foo.desktop" may live at
+// kde4/foo.desktop; every dash that names an existing subdirectory is tried.
+bool desktopFileExists(const QString &dir, const QString &id) {
+  if (QFileInfo(dir + '/' + id).isFile()) {
+    return true;
+  }
+
+  for (qsizetype dash = id.indexOf('-'); dash > 0; dash = id.indexOf('-', dash + 1)) {
+    const QString subdir = dir + '/' + id.left(dash);
+    if (QFileInfo(subdir).isDir() && desktopFileExists(subdir, id.mid(dash + 1))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void appendUnique(QStringList &list, const QString &id) {
+  if (!list.contains(id)) {
+    list.append(id);
+  }
+}
 } // namespace
 
+AppRegistry::AppRegistry(const XdgEnvironment &env) : m_env(env) {
+}
+
 void AppRegistry::load() {
+  ALLOCATION_PHASE("AppRegistry::load");
   m_apps.clear();
   m_mimeToApps.clear();
+  m_executables = ExecutableIndex::current(m_env);
 
-  const QStringList appDirs = XdgPaths::appDirs();
+  const QStringList appDirs = m_env.appDirs();
   for (const QString &dir : appDirs) {
-    QDirIterator it(dir, QStringList() << "*.desktop", QDir::Files, QDirIterator::Subdirectories);
+    indexDirectory(dir);
+  }
+}
+
+void AppRegistry::loadSystemLayer() {
+  ALLOCATION_PHASE("AppRegistry::load");
+  m_apps.clear();
+  m_mimeToApps.clear();
+  m_executables = ExecutableIndex::current(m_env);
 
-    while (it.hasNext()) {
-      const QString filePath = it.next();
-      const QString desktopId = desktopIdForFile(filePath, dir);
+  const QStringList appDirs = m_env.systemAppDirs();
+  for (const QString &dir : appDirs) {
+    indexDirectory(dir);
+  }
+}
 
-      if (desktopId.isEmpty() || m_apps.contains(desktopId)) {
-        continue;
-      }
+AppRegistry AppRegistry::withUserLayer(const XdgEnvironment &env) const {
+  AppRegistry merged(*this);
+  merged.m_env = env;
 
-      indexDesktopFile(filePath, dir);
+  AppRegistry user(env);
+  user.m_executables = m_executables;
+  user.indexDirectory(env.userAppDir());
+  if (user.m_apps.isEmpty()) {
+    return merged;
+  }
+
+  for (auto it = user.m_apps.cbegin(); it != user.m_apps.cend(); ++it) {
+    const auto shadowed = merged.m_apps.constFind(it.key());
+    if (shadowed != merged.m_apps.cend()) {
+      realize(*shadowed.value());
+      for (const QString &mime : shadowed.value()->info.mimeTypes) {
+        merged.m_mimeToApps[mime].removeAll(it.key());
+      }
     }
+    merged.m_apps.insert(it.key(), it.value());
+  }
+
+  // User applications are scanned first by load(), so they lead every per-type list.
+  for (auto it = user.m_mimeToApps.cbegin(); it != user.m_mimeToApps.cend(); ++it) {
+    QStringList &list = merged.m_mimeToApps[it.key()];
+    list = it.value() + list;
   }
+
+  return merged;
+}
+
+const XdgEnvironment &AppRegistry::environment() const {
+  return m_env;
 }
 
 const AppInfo *AppRegistry::findById(const QString &id) const {
-  auto it = m_apps.find(id);
+  const auto it = m_apps.constFind(id);
 
-  if (it == m_apps.end()) {
+  if (it == m_apps.constEnd() || !realize(*it.value())) {
     return nullptr;
   }
 
-  return &it.value();
+  return &it.value()->info;
 }
 
 QString AppRegistry::appDisplayName(const QString &id) const {
@@ -106,66 +270,160 @@ QString AppRegistry::appDisplayName(const QString &id) const {
 }
 
 QStringList AppRegistry::appsForMime(const QString &mime) const {
-  return m_mimeToApps.value(mime);
+  const QStringList ids = m_mimeToApps.value(mime);
+
+  // Rows from a mimeinfo.cache can name entries that turn out to be hidden or not
+  // applications once parsed; only copy the list when that actually happens.
+  for (int i = 0; i < ids.size(); ++i) {
+    if (findById(ids[i])) {
+      continue;
+    }
+
+    QStringList usable = ids.mid(0, i);
+    for (int j = i + 1; j < ids.size(); ++j) {
+      if (findById(ids[j])) {
+        usable.append(ids[j]);
+      }
+    }
+    return usable;
+  }
+
+  return ids;
 }
 
 QList<AppInfo> AppRegistry::allApps() const {
-  return m_apps.values();
+  QList<AppInfo> apps;
+  apps.reserve(m_apps.size());
+
+  for (auto it = m_apps.cbegin(); it != m_apps.cend(); ++it) {
+    if (realize(*it.value())) {
+      apps.append(it.value()->info);
+    }
+  }
+
+  return apps;
 }
 
-void AppRegistry::indexDesktopFile(const QString &filePath, const QString &baseDir) {
-  const QString desktopId = desktopIdForFile(filePath, baseDir);
+bool AppRegistry::hasDesktopFile(const QString &id) const {
+  // Deliberately not findById(): that also rejects entries which are installed but unusable.
+  if (id.isEmpty()) {
+    return false;
+  }
 
-  if (desktopId.isEmpty() || m_apps.contains(desktopId)) {
-    return;
+  if (m_apps.contains(id)) {
+    return true;
   }
 
-  QSettings settings(filePath, QSettings::IniFormat);
-  settings.beginGroup("Desktop Entry");
+  QStringList dirs = m_env.appDirs();
+  dirs.append(m_env.userAppDir());
+  for (const QString &dir : dirs) {
+    if (desktopFileExists(dir, id)) {
+      return true;
+    }
+  }
 
-  const QString type = settings.value("Type").toString().trimmed();
-  if (!type.isEmpty() && type.compare("Application", Qt::CaseInsensitive) != 0) {
+  return false;
+}
+
+void AppRegistry::indexDirectory(const QString &dir) {
+  // The first directory that has a desktop ID owns it, even if its entry is later found to be
+  // unusable (Hidden, not an application, TryExec missing); that is what lets a user file mask a
+  // system one. A NoDisplay entry is usable and keeps handling its types.
+  QVector<AppRecordPtr> records;
+  QDirIterator it(dir, QStringList() << "*.desktop", QDir::Files, QDirIterator::Subdirectories);
+
+  while (it.hasNext()) {
+    const QString filePath = it.next();
+    const QString desktopId = desktopIdForFile(filePath, dir);
+
+    if (desktopId.isEmpty() || m_apps.contains(desktopId)) {
+      continue;
+    }
+
+    auto record = std::make_shared<AppRecord>();
+    record->info.desktopId = desktopId;
+    record->info.desktopPath = filePath;
+    record->baseDir = dir;
+    record->executables = m_executables;
+    m_apps.insert(desktopId, record);
+    records.append(record);
+  }
+
+  if (records.isEmpty()) {
     return;
   }
 
-  const bool noDisplay = settings.value("NoDisplay", false).toBool();
-  const bool hidden = settings.value("Hidden", false).toBool();
-  if (noDisplay || hidden) {
+  const bool fromCache = indexFromMimeinfoCache(dir);
+  RuntimeCounters::add(fromCache ? RuntimeCounters::MimeinfoCacheHits
+                                 : RuntimeCounters::MimeinfoCacheMisses);
+  if (fromCache) {
     return;
   }
 
-  AppInfo app;
-  app.desktopId = desktopId;
-  app.desktopPath = filePath;
-  app.name = settings.value("Name").toString().trimmed();
-  app.exec = settings.value("Exec").toString().trimmed();
-  app.iconName = settings.value("Icon").toString().trimmed();
+  for (const AppRecordPtr &record : records) {
+    if (!realize(*record)) {
+      continue;
+    }
 
-  app.mimeTypes = parseMimeTypesFromDesktopFile(filePath);
-  if (app.mimeTypes.isEmpty()) {
-    const QString mimeValue = settings.value("MimeType").toString();
-    const QStringList mimeParts = mimeValue.split(';', Qt::SkipEmptyParts);
-    for (const QString &part : mimeParts) {
-      const QString trimmed = part.trimmed();
+    for (const QString &mime : record->info.mimeTypes) {
+      appendUnique(m_mimeToApps[mime], record->info.desktopId);
+    }
+  }
+}
 
-      if (!trimmed.isEmpty()) {
-        app.mimeTypes.append(trimmed);
-      }
+bool AppRegistry::indexFromMimeinfoCache(const QString &dir) {
+  const QFileInfo cacheInfo(dir + "/mimeinfo.cache");
+  if (!cacheInfo.isFile()) {
+    return false;
+  }
+
+  // The cache is stale once any directory it covers changed after it was written.
+  const QDateTime cacheTime = cacheInfo.lastModified();
+  if (QFileInfo(dir).lastModified() > cacheTime) {
+    return false;
+  }
+
+  QDirIterator dirs(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (dirs.hasNext()) {
+    dirs.next();
+    if (dirs.fileInfo().lastModified() > cacheTime) {
+      return false;
     }
   }
 
-  if (app.name.isEmpty()) {
-    app.name = desktopId;
+  QHash<QString, QStringList> cache;
+  if (!parseMimeinfoCache(cacheInfo.filePath(), cache)) {
+    return false;
   }
 
-  m_apps.insert(desktopId, app);
+  for (auto entry = cache.cbegin(); entry != cache.cend(); ++entry) {
+    for (const QString &id : entry.value()) {
+      const auto record = m_apps.constFind(id);
 
-  for (const QString &mime : app.mimeTypes) {
-    QStringList &list = m_mimeToApps[mime];
-    if (!list.contains(desktopId)) {
-      list.append(desktopId);
+      if (record != m_apps.cend() && record.value()->baseDir == dir) {
+        appendUnique(m_mimeToApps[entry.key()], id);
+      }
     }
   }
+
+  return true;
+}
+
+bool AppRegistry::realize(AppRecord &record) {
+  int state = record.state.load(std::memory_order_acquire);
+  if (state != AppRecord::Unparsed) {
+    return state == AppRecord::Valid;
+  }
+
+  QMutexLocker locker(&record.mutex);
+  state = record.state.load(std::memory_order_relaxed);
+  if (state == AppRecord::Unparsed) {
+    state = parseDesktopFile(record.info, record.executables.get()) ? AppRecord::Valid
+                                                                    : AppRecord::Invalid;
+    record.state.store(state, std::memory_order_release);
+  }
+
+  return state == AppRecord::Valid;
 }
 
 QString AppRegistry::desktopIdForFile(const QString &filePath, const QString &baseDir) const {
@@ -1,10 +1,18 @@
 #pragma once
 
+#include "utils/XdgEnvironment.h"
+
 #include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 
+#include <atomic>
+#include <memory>
+
+class ExecutableIndex;
+
 struct AppInfo {
   QString desktopId;
   QString name;
@@ -16,17 +24,46 @@ struct AppInfo {
 
 class AppRegistry {
 public:
+  explicit AppRegistry(const XdgEnvironment &env);
+
   void load();
+  void loadSystemLayer();
+  // Copy sharing this registry's parsed system layer, overlaid with the applications in env's
+  // user directory; those shadow system entries with the same desktop ID.
+  AppRegistry withUserLayer(const XdgEnvironment &env) const;
+  const XdgEnvironment &environment() const;
 
   const AppInfo *findById(const QString &id) const;
   QString appDisplayName(const QString &id) const;
   QStringList appsForMime(const QString &mime) const;
   QList<AppInfo> allApps() const;
+  // Whether any application directory still holds a desktop file for id, usable or not:
+  // hidden, NoDisplay and TryExec-failing entries count. Files added since load() are found on
+  // disk, so a stale registry never makes a live ID look dead.
+  bool hasDesktopFile(const QString &id) const;
 
 private:
-  void indexDesktopFile(const QString &filePath, const QString &baseDir);
+  // Desktop files are registered when their directory is listed and parsed the first time one
+  // of their details is needed. Parsing is guarded per record so lookups stay safe from the
+  // resolver's worker threads, and records are shared between copies of the registry.
+  struct AppRecord {
+    enum State { Unparsed, Valid, Invalid };
+
+    AppInfo info;
+    QString baseDir;
+    std::shared_ptr<const ExecutableIndex> executables;
+    QMutex mutex;
+    std::atomic<int> state{Unparsed};
+  };
+  using AppRecordPtr = std::shared_ptr<AppRecord>;
+
+  void indexDirectory(const QString &dir);
+  bool indexFromMimeinfoCache(const QString &dir);
+  static bool realize(AppRecord &record);
   QString desktopIdForFile(const QString &filePath, const QString &baseDir) const;
 
-  QHash<QString, AppInfo> m_apps;
+  XdgEnvironment m_env;
+  QHash<QString, AppRecordPtr> m_apps;
   QHash<QString, QStringList> m_mimeToApps;
+  std::shared_ptr<const ExecutableIndex> m_executables;
 };
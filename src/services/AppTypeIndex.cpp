@@ -0,0 +1,83 @@
+#include "services/AppTypeIndex.h"
+
+#include <algorithm>
+
+namespace {
+QStringList sortedTypes(const QHash<QString, QSet<QString>> &index, const QString &desktopId) {
+  const auto it = index.constFind(desktopId);
+  if (it == index.cend()) {
+    return {};
+  }
+
+  QStringList types(it.value().cbegin(), it.value().cend());
+  std::sort(types.begin(), types.end());
+  return types;
+}
+
+void removeType(QHash<QString, QSet<QString>> &index, const QString &desktopId,
+                const QString &mime) {
+  const auto it = index.find(desktopId);
+  if (it == index.end()) {
+    return;
+  }
+
+  it.value().remove(mime);
+  if (it.value().isEmpty()) {
+    index.erase(it);
+  }
+}
+} // namespace
+
+void AppTypeIndex::reset(const QVector<MimeEntry> &entries) {
+  m_byType.clear();
+  m_handled.clear();
+  m_defaults.clear();
+  m_byType.reserve(entries.size());
+
+  for (const MimeEntry &entry : entries) {
+    const Contribution contribution{entry.defaultAppId, entry.associatedAppIds};
+    add(entry.mimeType, contribution);
+    m_byType.insert(entry.mimeType, contribution);
+  }
+}
+
+void AppTypeIndex::update(const QVector<MimeEntry> &entries) {
+  for (const MimeEntry &entry : entries) {
+    const auto previous = m_byType.constFind(entry.mimeType);
+    if (previous != m_byType.cend()) {
+      retract(entry.mimeType, previous.value());
+    }
+
+    const Contribution contribution{entry.defaultAppId, entry.associatedAppIds};
+    add(entry.mimeType, contribution);
+    m_byType.insert(entry.mimeType, contribution);
+  }
+}
+
+QStringList AppTypeIndex::typesHandledBy(const QString &desktopId) const {
+  return sortedTypes(m_handled, desktopId);
+}
+
+QStringList AppTypeIndex::typesDefaultingTo(const QString &desktopId) const {
+  return sortedTypes(m_defaults, desktopId);
+}
+
+void AppTypeIndex::retract(const QString &mime, const Contribution &contribution) {
+  if (!contribution.defaultAppId.isEmpty()) {
+    removeType(m_defaults, contribution.defaultAppId, mime);
+  }
+
+  for (const QString &id : contribution.associatedAppIds) {
+    removeType(m_handled, id, mime);
+  }
+}
+
+void AppTypeIndex::add(const QString &mime, const Contribution &contribution) {
+  if (!contribution.defaultAppId.isEmpty()) {
+    m_defaults[contribution.defaultAppId].insert(mime);
+  }
+
+  for (const QString &id : contribution.associatedAppIds) {
+    m_handled[id].insert(mime);
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "services/MimeAssociationService.h"
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Reverse of the resolved association table: for each application, the types it can open and
+// the types it is the effective default for. Kept in step with the entries by update(), so
+// asking about one application never scans every type.
+class AppTypeIndex {
+public:
+  void reset(const QVector<MimeEntry> &entries);
+  // Replaces what each entry's type contributed with the entry's current resolution.
+  void update(const QVector<MimeEntry> &entries);
+
+  // Both sorted by type name.
+  QStringList typesHandledBy(const QString &desktopId) const;
+  QStringList typesDefaultingTo(const QString &desktopId) const;
+
+private:
+  struct Contribution {
+    QString defaultAppId;
+    QStringList associatedAppIds;
+  };
+
+  void retract(const QString &mime, const Contribution &contribution);
+  void add(const QString &mime, const Contribution &contribution);
+
+  // What each type last contributed, so update() can take exactly that back out.
+  QHash<QString, Contribution> m_byType;
+  QHash<QString, QSet<QString>> m_handled;
+  QHash<QString, QSet<QString>> m_defaults;
+};
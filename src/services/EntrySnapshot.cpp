@@ -0,0 +1,365 @@
+#include "services/EntrySnapshot.h"
+
+#include "utils/AllocationStats.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QLocale>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr char SnapshotMagic[8] = {'M', 'I', 'M', 'E', 'S', 'N', 'A', 'P'};
+constexpr quint32 SnapshotVersion = 1;
+constexpr quint32 NoString = 0xffffffffu;
+constexpr int FingerprintSize = 20;
+
+// Entries are {mime, default, first association, association count}; categories are
+// {name, first entry, entry count}. Every reference into the string table is an index.
+constexpr int EntryFields = 4;
+constexpr int CategoryFields = 3;
+
+struct SnapshotHeader {
+  char magic[8];
+  quint32 version;
+  quint32 fileSize;
+  char fingerprint[FingerprintSize];
+  quint32 stringCount;
+  quint32 stringOffsetsPos; // stringCount + 1 offsets into the UTF-16 data, in code units.
+  quint32 stringDataPos;
+  quint32 idCount;
+  quint32 idListPos;
+  quint32 entryCount;
+  quint32 entriesPos;
+  quint32 categoryCount;
+  quint32 categoriesPos;
+};
+
+static_assert(sizeof(SnapshotHeader) % sizeof(quint32) == 0,
+              "sections after the header must stay word aligned");
+
+struct StringTable {
+  QHash<QString, quint32> indices;
+  QVector<quint32> offsets{0};
+  QString data;
+
+  quint32 intern(const QString &value) {
+    const auto it = indices.constFind(value);
+    if (it != indices.cend()) {
+      return it.value();
+    }
+
+    const quint32 index = static_cast<quint32>(offsets.size() - 1);
+    indices.insert(value, index);
+    data.append(value);
+    offsets.append(static_cast<quint32>(data.size()));
+    return index;
+  }
+};
+
+quint32 appendWords(QByteArray &buffer, const QVector<quint32> &words) {
+  const quint32 pos = static_cast<quint32>(buffer.size());
+  buffer.append(reinterpret_cast<const char *>(words.constData()),
+                words.size() * static_cast<qsizetype>(sizeof(quint32)));
+  return pos;
+}
+
+void addStat(QCryptographicHash &hash, const QString &path) {
+  const QFileInfo info(path);
+  QByteArray line = path.toUtf8();
+
+  if (info.exists()) {
+    line += ':' + QByteArray::number(info.size()) + ':' +
+            QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+  } else {
+    line += ":-";
+  }
+
+  line += '\n';
+  hash.addData(line);
+}
+} // namespace
+
+QString EntrySnapshot::defaultPath(const XdgEnvironment &env) {
+  return env.cacheHome() + "/mime-settings/entries.snapshot";
+}
+
+QByteArray EntrySnapshot::fingerprint(const XdgEnvironment &env) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray(qVersion()) + '\n' + QLocale::system().name().toUtf8() + '\n');
+
+  addStat(hash, env.userMimeappsPath());
+  for (const QString &dir : env.configDirs()) {
+    addStat(hash, dir + "/mimeapps.list");
+  }
+
+  for (const QString &dir : env.dataDirs()) {
+    addStat(hash, dir + "/applications/mimeapps.list");
+  }
+
+  // Adding or removing a desktop file touches its directory, but editing one in place does not.
+  // Package updates refresh mimeinfo.cache, so a directory whose cache is as new as the
+  // directory tree is covered by the cache's stamp, the same rule AppRegistry indexes by. Only
+  // directories without a fresh cache, typically the user's, pay a stat per desktop file.
+  addStat(hash, env.userAppDir());
+  for (const QString &dir : env.appDirs()) {
+    addStat(hash, dir);
+    const QFileInfo cache(dir + "/mimeinfo.cache");
+    addStat(hash, cache.filePath());
+    bool cacheFresh = cache.isFile() && QFileInfo(dir).lastModified() <= cache.lastModified();
+
+    QDirIterator dirs(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (dirs.hasNext()) {
+      const QString subdir = dirs.next();
+      addStat(hash, subdir);
+      cacheFresh = cacheFresh && dirs.fileInfo().lastModified() <= cache.lastModified();
+    }
+
+    if (cacheFresh) {
+      continue;
+    }
+
+    QDirIterator files(dir, {"*.desktop"}, QDir::Files, QDirIterator::Subdirectories);
+    while (files.hasNext()) {
+      addStat(hash, files.next());
+    }
+  }
+
+  // TryExec hides entries whose binary is gone, so PATH changes count too.
+  for (const QString &dir : env.executableDirs()) {
+    addStat(hash, dir);
+  }
+
+  addStat(hash, env.dataHome() + "/mime/mime.cache");
+  for (const QString &dir : env.dataDirs()) {
+    addStat(hash, dir + "/mime/mime.cache");
+  }
+
+  return hash.result();
+}
+
+bool EntrySnapshot::write(const QString &path, const QByteArray &fingerprint,
+                          const QVector<MimeEntry> &entries) {
+  ALLOCATION_PHASE("EntrySnapshot::write");
+  if (fingerprint.size() != FingerprintSize) {
+    return false;
+  }
+
+  // Rows are stored in the order MimeTypeModel shows them: categories sorted, and each
+  // category keeping the order of the input.
+  QHash<QString, QVector<int>> grouped;
+  for (int i = 0; i < entries.size(); ++i) {
+    grouped[MimeAssociationService::categoryFor(entries[i].mimeType)].append(i);
+  }
+
+  QStringList categoryNames = grouped.keys();
+  std::sort(categoryNames.begin(), categoryNames.end(), [](const QString &a, const QString &b) {
+    return QString::localeAwareCompare(a, b) < 0;
+  });
+
+  StringTable strings;
+  QVector<quint32> ids;
+  QVector<quint32> entryWords;
+  QVector<quint32> categoryWords;
+  entryWords.reserve(entries.size() * EntryFields);
+  categoryWords.reserve(categoryNames.size() * CategoryFields);
+
+  for (const QString &name : categoryNames) {
+    const QVector<int> &rows = grouped[name];
+    categoryWords << strings.intern(name) << static_cast<quint32>(entryWords.size() / EntryFields)
+                  << static_cast<quint32>(rows.size());
+
+    for (int row : rows) {
+      const MimeEntry &entry = entries[row];
+      entryWords << strings.intern(entry.mimeType)
+                 << (entry.defaultAppId.isEmpty() ? NoString : strings.intern(entry.defaultAppId))
+                 << static_cast<quint32>(ids.size())
+                 << static_cast<quint32>(entry.associatedAppIds.size());
+
+      for (const QString &id : entry.associatedAppIds) {
+        ids.append(strings.intern(id));
+      }
+    }
+  }
+
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+  std::memcpy(header.fingerprint, fingerprint.constData(), FingerprintSize);
+  header.version = SnapshotVersion;
+  header.stringCount = static_cast<quint32>(strings.offsets.size() - 1);
+  header.idCount = static_cast<quint32>(ids.size());
+  header.entryCount = static_cast<quint32>(entryWords.size() / EntryFields);
+  header.categoryCount = static_cast<quint32>(categoryNames.size());
+
+  QByteArray buffer(sizeof(SnapshotHeader), '\0');
+  header.stringOffsetsPos = appendWords(buffer, strings.offsets);
+  header.idListPos = appendWords(buffer, ids);
+  header.entriesPos = appendWords(buffer, entryWords);
+  header.categoriesPos = appendWords(buffer, categoryWords);
+  header.stringDataPos = static_cast<quint32>(buffer.size());
+  buffer.append(reinterpret_cast<const char *>(strings.data.utf16()),
+                strings.data.size() * static_cast<qsizetype>(sizeof(char16_t)));
+  header.fileSize = static_cast<quint32>(buffer.size());
+  std::memcpy(buffer.data(), &header, sizeof(header));
+
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  file.write(buffer);
+  return file.commit();
+}
+
+std::unique_ptr<EntrySnapshot> EntrySnapshot::open(const QString &path,
+                                                   const QByteArray &fingerprint) {
+  std::unique_ptr<EntrySnapshot> snapshot(new EntrySnapshot);
+  snapshot->m_file.setFileName(path);
+  if (!snapshot->m_file.open(QIODevice::ReadOnly)) {
+    return nullptr;
+  }
+
+  const qint64 size = snapshot->m_file.size();
+  if (size < static_cast<qint64>(sizeof(SnapshotHeader))) {
+    return nullptr;
+  }
+
+  const uchar *data = snapshot->m_file.map(0, size);
+  if (!data || !snapshot->validate(data, size, fingerprint)) {
+    return nullptr;
+  }
+
+  return snapshot;
+}
+
+int EntrySnapshot::categoryCount() const {
+  return static_cast<int>(m_categoryCount);
+}
+
+QStringView EntrySnapshot::categoryName(int category) const {
+  return string(m_categories[category * CategoryFields]);
+}
+
+int EntrySnapshot::entryCount(int category) const {
+  return static_cast<int>(m_categories[category * CategoryFields + 2]);
+}
+
+QStringView EntrySnapshot::mimeType(int category, int row) const {
+  return string(entryRecord(category, row)[0]);
+}
+
+MimeEntry EntrySnapshot::entry(int category, int row) const {
+  const quint32 *record = entryRecord(category, row);
+
+  MimeEntry entry;
+  entry.mimeType = string(record[0]).toString();
+  if (record[1] != NoString) {
+    entry.defaultAppId = string(record[1]).toString();
+  }
+
+  entry.associatedAppIds.reserve(record[3]);
+  for (quint32 i = 0; i < record[3]; ++i) {
+    entry.associatedAppIds.append(string(m_ids[record[2] + i]).toString());
+  }
+
+  return entry;
+}
+
+QVector<MimeEntry> EntrySnapshot::allEntries() const {
+  QVector<MimeEntry> entries;
+  for (int category = 0; category < categoryCount(); ++category) {
+    const int count = entryCount(category);
+    for (int row = 0; row < count; ++row) {
+      entries.append(entry(category, row));
+    }
+  }
+
+  return entries;
+}
+
+bool EntrySnapshot::validate(const uchar *data, qint64 size, const QByteArray &fingerprint) {
+  SnapshotHeader header;
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) != 0 ||
+      header.version != SnapshotVersion || header.fileSize != size ||
+      fingerprint.size() != FingerprintSize ||
+      std::memcmp(header.fingerprint, fingerprint.constData(), FingerprintSize) != 0) {
+    return false;
+  }
+
+  // The file is trusted only as far as its own bounds: every index is checked once here so
+  // the accessors can read without checks.
+  const auto fits = [size](quint64 pos, quint64 words) {
+    return pos % sizeof(quint32) == 0 && pos + words * sizeof(quint32) <= quint64(size);
+  };
+  if (!fits(header.stringOffsetsPos, quint64(header.stringCount) + 1) ||
+      !fits(header.idListPos, header.idCount) ||
+      !fits(header.entriesPos, quint64(header.entryCount) * EntryFields) ||
+      !fits(header.categoriesPos, quint64(header.categoryCount) * CategoryFields) ||
+      header.stringDataPos % sizeof(char16_t) != 0 || header.stringDataPos > size) {
+    return false;
+  }
+
+  const quint32 *offsets = reinterpret_cast<const quint32 *>(data + header.stringOffsetsPos);
+  const quint64 dataUnits = (quint64(size) - header.stringDataPos) / sizeof(char16_t);
+  for (quint32 i = 0; i < header.stringCount; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      return false;
+    }
+  }
+  if (offsets[header.stringCount] > dataUnits) {
+    return false;
+  }
+
+  const quint32 *ids = reinterpret_cast<const quint32 *>(data + header.idListPos);
+  for (quint32 i = 0; i < header.idCount; ++i) {
+    if (ids[i] >= header.stringCount) {
+      return false;
+    }
+  }
+
+  const quint32 *entries = reinterpret_cast<const quint32 *>(data + header.entriesPos);
+  for (quint32 i = 0; i < header.entryCount; ++i) {
+    const quint32 *record = entries + quint64(i) * EntryFields;
+    if (record[0] >= header.stringCount ||
+        (record[1] != NoString && record[1] >= header.stringCount) ||
+        quint64(record[2]) + record[3] > header.idCount) {
+      return false;
+    }
+  }
+
+  const quint32 *categories = reinterpret_cast<const quint32 *>(data + header.categoriesPos);
+  for (quint32 i = 0; i < header.categoryCount; ++i) {
+    const quint32 *record = categories + quint64(i) * CategoryFields;
+    if (record[0] >= header.stringCount || quint64(record[1]) + record[2] > header.entryCount) {
+      return false;
+    }
+  }
+
+  m_categoryCount = header.categoryCount;
+  m_stringOffsets = offsets;
+  m_stringData = reinterpret_cast<const char16_t *>(data + header.stringDataPos);
+  m_ids = ids;
+  m_entries = entries;
+  m_categories = categories;
+  return true;
+}
+
+QStringView EntrySnapshot::string(quint32 index) const {
+  const quint32 begin = m_stringOffsets[index];
+  return QStringView(m_stringData + begin, m_stringOffsets[index + 1] - begin);
+}
+
+const quint32 *EntrySnapshot::entryRecord(int category, int row) const {
+  const quint32 first = m_categories[category * CategoryFields + 1];
+  return m_entries + (quint64(first) + row) * EntryFields;
+}
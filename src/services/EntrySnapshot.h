@@ -0,0 +1,52 @@
+#pragma once
+
+#include "services/MimeAssociationService.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <memory>
+
+class XdgEnvironment;
+
+// Read-only view of a resolved association table written by write(). The file is mapped and
+// read in place; only the rows a caller asks for are turned into QStrings.
+class EntrySnapshot {
+public:
+  static QString defaultPath(const XdgEnvironment &env);
+  // Hash over the stat data of everything buildEntries() depends on.
+  static QByteArray fingerprint(const XdgEnvironment &env);
+  static bool write(const QString &path, const QByteArray &fingerprint,
+                    const QVector<MimeEntry> &entries);
+  // Returns null when the file is missing, malformed or was built from other inputs.
+  static std::unique_ptr<EntrySnapshot> open(const QString &path, const QByteArray &fingerprint);
+
+  int categoryCount() const;
+  QStringView categoryName(int category) const;
+  int entryCount(int category) const;
+  QStringView mimeType(int category, int row) const;
+  MimeEntry entry(int category, int row) const;
+  // Every row, category by category.
+  QVector<MimeEntry> allEntries() const;
+
+  EntrySnapshot(const EntrySnapshot &) = delete;
+  EntrySnapshot &operator=(const EntrySnapshot &) = delete;
+
+private:
+  EntrySnapshot() = default;
+
+  bool validate(const uchar *data, qint64 size, const QByteArray &fingerprint);
+  QStringView string(quint32 index) const;
+  const quint32 *entryRecord(int category, int row) const;
+
+  QFile m_file;
+  quint32 m_categoryCount = 0;
+  const quint32 *m_stringOffsets = nullptr;
+  const char16_t *m_stringData = nullptr;
+  const quint32 *m_ids = nullptr;
+  const quint32 *m_entries = nullptr;
+  const quint32 *m_categories = nullptr;
+};
@@ -0,0 +1,60 @@
+#include "services/ExecutableIndex.h"
+
+#include "utils/XdgEnvironment.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+std::shared_ptr<const ExecutableIndex> ExecutableIndex::current(const XdgEnvironment &env) {
+  // Listings outlive the registries that use them; a reload re-stats the directories and
+  // relists only the ones that changed.
+  static QMutex mutex;
+  static QHash<QString, std::shared_ptr<const DirListing>> listings;
+
+  auto index = std::shared_ptr<ExecutableIndex>(new ExecutableIndex);
+  index->m_rootPrefix = env.rootPrefix();
+
+  const QStringList dirs = env.executableDirs();
+  QMutexLocker locker(&mutex);
+  for (const QString &dir : dirs) {
+    const qint64 mtime = QFileInfo(dir).lastModified().toMSecsSinceEpoch();
+
+    auto &listing = listings[dir];
+    if (!listing || listing->mtime != mtime) {
+      auto fresh = std::make_shared<DirListing>();
+      fresh->mtime = mtime;
+
+      QDirIterator it(dir, QDir::Files | QDir::Executable);
+      while (it.hasNext()) {
+        it.next();
+        fresh->names.insert(it.fileName());
+      }
+      listing = std::move(fresh);
+    }
+
+    index->m_listings.append(listing);
+  }
+
+  return index;
+}
+
+bool ExecutableIndex::canRun(const QString &tryExec) const {
+  if (tryExec.startsWith('/')) {
+    const QString path = m_rootPrefix + QDir::cleanPath(tryExec);
+    const QFileInfo info(path);
+    return info.isFile() && info.isExecutable();
+  }
+
+  for (const auto &listing : m_listings) {
+    if (listing->names.contains(tryExec)) {
+      return true;
+    }
+  }
+
+  return false;
+}
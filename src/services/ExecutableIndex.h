@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+class XdgEnvironment;
+
+// Executable names found in the PATH directories, for TryExec checks. Each directory is listed
+// once and its listing reused until the directory's mtime changes, so testing thousands of
+// desktop entries costs a hash lookup each instead of a stat per PATH entry.
+class ExecutableIndex {
+public:
+  // Index for env's PATH; stats each directory and relists only those that changed.
+  static std::shared_ptr<const ExecutableIndex> current(const XdgEnvironment &env);
+
+  // True when tryExec names an executable: an absolute path is checked inside the root,
+  // a bare name is looked up in the listings.
+  bool canRun(const QString &tryExec) const;
+
+private:
+  struct DirListing {
+    qint64 mtime = 0;
+    QSet<QString> names;
+  };
+
+  QString m_rootPrefix;
+  QVector<std::shared_ptr<const DirListing>> m_listings;
+};
@@ -2,14 +2,53 @@
 
 #include "services/AppRegistry.h"
 #include "services/MimeDefaultsStore.h"
+#include "utils/AllocationStats.h"
+#include "utils/RuntimeCounters.h"
 
 #include <QMimeDatabase>
 #include <QMimeType>
-#include <QSet>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
 
 #include <algorithm>
 
 namespace {
+// Types resolved per pool task; small enough to balance the uneven per-type cost.
+constexpr int ResolveChunkSize = 128;
+
+// Per-task buffers reused across the types of a chunk so each resolution does not allocate its
+// own key and candidate containers.
+struct ResolveScratch {
+  QStringList mimeKeys;
+  QStringList appIds;
+  QStringList preferredIds;
+};
+
+struct StoreLayers {
+  QHash<QString, QStringList> userDefaults;
+  QHash<QString, QStringList> systemDefaults;
+  QHash<QString, QStringList> userAssoc;
+  QHash<QString, QStringList> systemAssoc;
+};
+
+StoreLayers snapshotLayers(const MimeDefaultsStore *store) {
+  StoreLayers layers;
+  layers.userDefaults = store->userDefaults();
+  layers.systemDefaults = store->systemDefaults();
+  layers.userAssoc = store->userAssociations();
+  layers.systemAssoc = store->systemAssociations();
+  return layers;
+}
+
+QList<QMimeType> sortedMimeTypes(const QMimeDatabase &db) {
+  QList<QMimeType> types = db.allMimeTypes();
+  std::sort(types.begin(), types.end(), [](const QMimeType &a, const QMimeType &b) {
+    return QString::localeAwareCompare(a.name(), b.name()) < 0;
+  });
+  return types;
+}
+
 QString firstInstalledId(const QStringList &candidates, const AppRegistry *registry) {
   for (const QString &id : candidates) {
     if (!id.isEmpty() && registry->findById(id)) {
@@ -20,114 +59,274 @@ QString firstInstalledId(const QStringList &candidates, const AppRegistry *regis
   return QString();
 }
 
-void addInstalled(QSet<QString> &target, const QStringList &candidates,
+void addInstalled(QStringList &target, const QStringList &candidates,
                   const AppRegistry *registry) {
   for (const QString &id : candidates) {
     if (!id.isEmpty() && registry->findById(id)) {
-      target.insert(id);
+      target.append(id);
     }
   }
 }
-} // namespace
 
-MimeAssociationService::MimeAssociationService(AppRegistry *registry, MimeDefaultsStore *store)
-    : m_registry(registry), m_store(store) {
+void addUnique(QStringList &target, const QStringList &ids) {
+  for (const QString &id : ids) {
+    if (!target.contains(id)) {
+      target.append(id);
+    }
+  }
 }
 
-QVector<MimeEntry> MimeAssociationService::buildEntries() const {
-  QMimeDatabase db;
-  QList<QMimeType> types = db.allMimeTypes();
-  std::sort(types.begin(), types.end(), [](const QMimeType &a, const QMimeType &b) {
-    return QString::localeAwareCompare(a.name(), b.name()) < 0;
-  });
+void addKey(QStringList &keys, const QString &key) {
+  if (!key.isEmpty() && !keys.contains(key)) {
+    keys.append(key);
+  }
+}
+
+// A non-empty user list decides on its own, even if none of its entries is installed.
+QString resolveDefault(const QString &mime, const QHash<QString, QStringList> &userDefaults,
+                       const QHash<QString, QStringList> &systemDefaults,
+                       const AppRegistry *registry) {
+  const QStringList userList = userDefaults.value(mime);
+  if (!userList.isEmpty()) {
+    return firstInstalledId(userList, registry);
+  }
 
-  const QHash<QString, QStringList> userDefaults = m_store->userDefaults();
-  const QHash<QString, QStringList> systemDefaults = m_store->systemDefaults();
-  const QHash<QString, QStringList> userAssoc = m_store->userAssociations();
-  const QHash<QString, QStringList> systemAssoc = m_store->systemAssociations();
+  const QStringList sysList = systemDefaults.value(mime);
+  if (!sysList.isEmpty()) {
+    return firstInstalledId(sysList, registry);
+  }
 
-  QVector<MimeEntry> entries;
-  entries.reserve(types.size());
+  return QString();
+}
 
-  for (const QMimeType &type : types) {
-    MimeEntry entry;
-    entry.mimeType = type.name();
-    entry.description = type.comment();
-
-    QString defaultId;
-    const QStringList userList = userDefaults.value(entry.mimeType);
-    if (!userList.isEmpty()) {
-      defaultId = firstInstalledId(userList, m_registry);
-    } else {
-      const QStringList sysList = systemDefaults.value(entry.mimeType);
-      if (!sysList.isEmpty()) {
-        defaultId = firstInstalledId(sysList, m_registry);
-      }
-    }
-    entry.defaultAppId = defaultId;
+MimeEntry resolveType(const QString &mime, const QMimeType &type, const StoreLayers &layers,
+                      const AppRegistry *registry, ResolveScratch &scratch) {
+  RuntimeCounters::add(RuntimeCounters::Resolutions);
 
-    QSet<QString> assoc;
-    QSet<QString> mimeKeys;
-    mimeKeys.insert(entry.mimeType);
+  MimeEntry entry;
+  entry.mimeType = mime;
 
-    const QStringList aliases = type.aliases();
-    for (const QString &alias : aliases) {
-      if (!alias.isEmpty()) {
-        mimeKeys.insert(alias);
-      }
-    }
+  const QString defaultId =
+      resolveDefault(mime, layers.userDefaults, layers.systemDefaults, registry);
+  entry.defaultAppId = defaultId;
 
-    const QStringList ancestors = type.allAncestors();
-    for (const QString &ancestor : ancestors) {
-      if (!ancestor.isEmpty()) {
-        mimeKeys.insert(ancestor);
-      }
-    }
+  QStringList &mimeKeys = scratch.mimeKeys;
+  mimeKeys.clear();
+  mimeKeys.append(entry.mimeType);
 
-    for (const QString &mimeKey : mimeKeys) {
-      const QStringList registryApps = m_registry->appsForMime(mimeKey);
-      for (const QString &id : registryApps) {
-        assoc.insert(id);
-      }
-    }
+  const QStringList aliases = type.aliases();
+  for (const QString &alias : aliases) {
+    addKey(mimeKeys, alias);
+  }
 
-    const QStringList userExtra = userAssoc.value(entry.mimeType);
-    addInstalled(assoc, userExtra, m_registry);
+  const QStringList ancestors = type.allAncestors();
+  for (const QString &ancestor : ancestors) {
+    addKey(mimeKeys, ancestor);
+  }
+
+  // Launch order: Added Associations, user before system, then cache rows for the type and its
+  // aliases, then for its ancestors. mimeKeys is already in that order.
+  QStringList &preferred = scratch.preferredIds;
+  preferred.clear();
+  addInstalled(preferred, layers.userAssoc.value(entry.mimeType), registry);
+  addInstalled(preferred, layers.systemAssoc.value(entry.mimeType), registry);
+  preferred.removeDuplicates();
+  for (const QString &mimeKey : mimeKeys) {
+    addUnique(preferred, registry->appsForMime(mimeKey));
+  }
+  entry.preferredAppIds = QStringList(preferred.cbegin(), preferred.cend());
+
+  QStringList &assoc = scratch.appIds;
+  assoc.clear();
+  assoc.append(preferred);
+
+  if (!defaultId.isEmpty()) {
+    assoc.append(defaultId);
+  }
+
+  // Equal ids compare equal under this ordering, so duplicates end up adjacent.
+  std::sort(assoc.begin(), assoc.end(), [registry](const QString &a, const QString &b) {
+    const QString nameA = registry->appDisplayName(a);
+    const QString nameB = registry->appDisplayName(b);
+    const int cmp = QString::localeAwareCompare(nameA, nameB);
+    return cmp == 0 ? a < b : cmp < 0;
+  });
+  assoc.erase(std::unique(assoc.begin(), assoc.end()), assoc.end());
+  entry.associatedAppIds = QStringList(assoc.cbegin(), assoc.cend());
+
+  return entry;
+}
+
+// Resolves count types into a vector in input order. Each task owns a disjoint slice of the
+// output and its own scratch buffers; the registry and store layers are only read.
+template <typename Resolve>
+QVector<MimeEntry> resolvePartitioned(int count, int threadCount, const Resolve &resolve) {
+  QVector<MimeEntry> entries(count);
+  if (count == 0) {
+    return entries;
+  }
 
-    const QStringList sysExtra = systemAssoc.value(entry.mimeType);
-    addInstalled(assoc, sysExtra, m_registry);
+  if (threadCount <= 0) {
+    threadCount = QThread::idealThreadCount();
+  }
 
-    if (!defaultId.isEmpty()) {
-      assoc.insert(defaultId);
+  MimeEntry *out = entries.data();
+  const int chunks = (count + ResolveChunkSize - 1) / ResolveChunkSize;
+  if (threadCount <= 1 || chunks <= 1) {
+    ResolveScratch scratch;
+    for (int i = 0; i < count; ++i) {
+      out[i] = resolve(i, scratch);
     }
+    return entries;
+  }
 
-    QStringList assocList = assoc.values();
-    std::sort(assocList.begin(), assocList.end(), [this](const QString &a, const QString &b) {
-      const QString nameA = m_registry->appDisplayName(a);
-      const QString nameB = m_registry->appDisplayName(b);
-      const int cmp = QString::localeAwareCompare(nameA, nameB);
-      return cmp == 0 ? a < b : cmp < 0;
+  ALLOCATION_PHASE_CAPTURE(phase);
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::min(threadCount, chunks));
+  for (int chunk = 0; chunk < chunks; ++chunk) {
+    const int begin = chunk * ResolveChunkSize;
+    const int end = std::min(begin + ResolveChunkSize, count);
+    pool.start([&resolve, out, begin, end, phase]() {
+      ALLOCATION_PHASE_ADOPT(phase);
+      ResolveScratch scratch;
+      for (int i = begin; i < end; ++i) {
+        out[i] = resolve(i, scratch);
+      }
     });
-    entry.associatedAppIds = assocList;
-
-    entries.append(entry);
   }
+  pool.waitForDone();
 
   return entries;
 }
+} // namespace
+
+MimeAssociationService::MimeAssociationService(AppRegistry *registry, MimeDefaultsStore *store)
+    : m_registry(registry), m_store(store) {
+}
+
+QStringList MimeAssociationService::mimeTypeNames() const {
+  QMimeDatabase db;
+  const QList<QMimeType> types = sortedMimeTypes(db);
+
+  QStringList names;
+  names.reserve(types.size());
+  for (const QMimeType &type : types) {
+    names.append(type.name());
+  }
+
+  return names;
+}
+
+QVector<MimeEntry> MimeAssociationService::buildEntries(int threadCount) const {
+  ALLOCATION_PHASE("MimeAssociationService::buildEntries");
+  QMimeDatabase db;
+  const QList<QMimeType> types = sortedMimeTypes(db);
+  const StoreLayers layers = snapshotLayers(m_store);
+  const AppRegistry *registry = m_registry;
+
+  return resolvePartitioned(static_cast<int>(types.size()), threadCount,
+                            [&types, &layers, registry](int i, ResolveScratch &scratch) {
+                              const QMimeType &type = types[i];
+                              return resolveType(type.name(), type, layers, registry, scratch);
+                            });
+}
+
+QVector<MimeEntry> MimeAssociationService::resolveEntries(const QStringList &mimes,
+                                                          int threadCount) const {
+  ALLOCATION_PHASE("MimeAssociationService::resolveEntries");
+  const StoreLayers layers = snapshotLayers(m_store);
+  const AppRegistry *registry = m_registry;
+
+  return resolvePartitioned(static_cast<int>(mimes.size()), threadCount,
+                            [&mimes, &layers, registry](int i, ResolveScratch &scratch) {
+                              QMimeDatabase db;
+                              const QString &mime = mimes[i];
+                              return resolveType(mime, db.mimeTypeForName(mime), layers, registry,
+                                                 scratch);
+                            });
+}
 
 MimeEntry MimeAssociationService::entryFor(const QString &mime) const {
-  const QVector<MimeEntry> entries = buildEntries();
+  const QVector<MimeEntry> entries = resolveEntries(QStringList{mime});
+  if (entries.isEmpty()) {
+    return MimeEntry{};
+  }
+
+  MimeEntry result = entries.first();
+  result.description = descriptionFor(mime);
+  return result;
+}
+
+QString MimeAssociationService::defaultFor(const QString &mime) const {
+  return resolveDefault(mime, m_store->userDefaults(), m_store->systemDefaults(), m_registry);
+}
 
-  for (const MimeEntry &entry : entries) {
-    if (entry.mimeType == mime) {
-      return entry;
+QString MimeAssociationService::descriptionFor(const QString &mime) const {
+  // Localized comments are the most expensive part of a QMimeType, so they are only looked up
+  // on demand instead of for every type in the database.
+  QMimeDatabase db;
+  return db.mimeTypeForName(mime).comment();
+}
+
+QStringList MimeAssociationService::typesAffectedBy(const QSet<QString> &keys) const {
+  QMimeDatabase db;
+  QStringList affected;
+  for (const QString &key : keys) {
+    const QMimeType type = db.mimeTypeForName(key);
+
+    if (type.isValid() && !affected.contains(type.name())) {
+      affected.append(type.name());
     }
   }
 
-  return MimeEntry{};
+  return affected;
 }
 
 void MimeAssociationService::setDefault(const QString &mime, const QString &desktopId) {
   m_store->setUserDefault(mime, desktopId);
 }
+
+QStringList MimeAssociationService::setDefaultForApp(const QString &desktopId,
+                                                     const QString &pattern) {
+  const AppInfo *app = m_registry->findById(desktopId);
+  if (!app) {
+    return {};
+  }
+
+  const QRegularExpression filter(
+      QRegularExpression::wildcardToRegularExpression(pattern.isEmpty() ? "*" : pattern,
+                                                      QRegularExpression::NonPathWildcard),
+      QRegularExpression::CaseInsensitiveOption);
+
+  // Defaults are looked up under canonical names, so aliases in the desktop file are mapped
+  // first; several of them can name the same type.
+  QMimeDatabase db;
+  QStringList changed;
+  for (const QString &declared : app->mimeTypes) {
+    const QMimeType type = db.mimeTypeForName(declared);
+    const QString mime = type.isValid() ? type.name() : declared;
+
+    if (changed.contains(mime) || !filter.match(mime).hasMatch() ||
+        defaultFor(mime) == desktopId) {
+      continue;
+    }
+
+    m_store->setUserDefault(mime, desktopId);
+    changed.append(mime);
+  }
+
+  return changed;
+}
+
+QString MimeAssociationService::categoryFor(const QString &mime) {
+  const QString category = mime.section('/', 0, 0);
+  return category.isEmpty() ? QString("other") : category;
+}
+
+QString MimeAssociationService::effectiveAppFor(const MimeEntry &entry) {
+  if (!entry.defaultAppId.isEmpty()) {
+    return entry.defaultAppId;
+  }
+
+  return entry.preferredAppIds.value(0);
+}
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
 struct MimeEntry {
   QString mimeType;
-  QString description;
+  QString description; // Left empty by buildEntries(); see descriptionFor().
   QString defaultAppId;
-  QStringList associatedAppIds;
+  QStringList associatedAppIds; // Sorted by display name, for showing.
+  // The same applications in the order a launcher tries them: Added Associations, then the
+  // type's own cache rows, then those of its parents. Resolved live only; snapshots omit it.
+  QStringList preferredAppIds;
 };
 
 class AppRegistry;
@@ -18,9 +22,29 @@ class MimeAssociationService {
 public:
   MimeAssociationService(AppRegistry *registry, MimeDefaultsStore *store);
 
-  QVector<MimeEntry> buildEntries() const;
+  QStringList mimeTypeNames() const;
+  // Both resolve in parallel on a private pool and return entries in input order;
+  // threadCount <= 0 uses QThread::idealThreadCount().
+  QVector<MimeEntry> buildEntries(int threadCount = 0) const;
+  QVector<MimeEntry> resolveEntries(const QStringList &mimes, int threadCount = 0) const;
   MimeEntry entryFor(const QString &mime) const;
+  // Effective default for one type without resolving its associations.
+  QString defaultFor(const QString &mime) const;
+  QString descriptionFor(const QString &mime) const;
+  // Canonical names of the types these store keys belong to (aliases map to their type).
+  // Store entries are looked up under the type's own name only, never inherited from
+  // ancestors, so no other type's resolution reads them.
+  QStringList typesAffectedBy(const QSet<QString> &keys) const;
   void setDefault(const QString &mime, const QString &desktopId);
+  // Makes desktopId the default for each type its MimeType= list declares that matches
+  // pattern (a wildcard such as "video/*"; empty matches all). Returns the canonical names of
+  // the types whose default changed, for the caller to persist and refresh in one batch.
+  QStringList setDefaultForApp(const QString &desktopId, const QString &pattern = QString());
+
+  // Top-level group a type is listed under ("other" for names without a media type).
+  static QString categoryFor(const QString &mime);
+  // What a launcher runs for the entry: its default, else the first preferred application.
+  static QString effectiveAppFor(const MimeEntry &entry);
 
 private:
   AppRegistry *m_registry;
@@ -1,23 +1,20 @@
 #include "services/MimeDefaultsStore.h"
 
-#include "utils/XdgPaths.h"
+#include "utils/AllocationStats.h"
+#include "utils/RuntimeCounters.h"
 
-#include <QDir>
 #include <QFile>
-#include <QFileInfo>
 #include <QTextStream>
 
+#include <algorithm>
+
 namespace {
-QHash<QString, QStringList> parseSectionEntries(const QString &filePath,
-                                                const QString &sectionName) {
-  QHash<QString, QStringList> result;
-  QFile file(filePath);
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    return result;
-  }
+enum class ListSection { Other, Defaults, Associations };
 
-  QTextStream in(&file);
-  bool inSection = false;
+// Reads both sections the store uses in a single pass over the stream.
+void parseMimeappsList(QTextStream &in, QHash<QString, QStringList> &defaults,
+                       QHash<QString, QStringList> &associations) {
+  ListSection section = ListSection::Other;
   while (!in.atEnd()) {
     const QString line = in.readLine();
     const QString trimmed = line.trimmed();
@@ -27,12 +24,18 @@ QHash<QString, QStringList> parseSectionEntries(const QString &filePath,
     }
 
     if (trimmed.startsWith('[') && trimmed.endsWith(']')) {
-      const QString section = trimmed.mid(1, trimmed.size() - 2).trimmed();
-      inSection = (section.compare(sectionName, Qt::CaseInsensitive) == 0);
+      const QString name = trimmed.mid(1, trimmed.size() - 2).trimmed();
+      if (name.compare("Default Applications", Qt::CaseInsensitive) == 0) {
+        section = ListSection::Defaults;
+      } else if (name.compare("Added Associations", Qt::CaseInsensitive) == 0) {
+        section = ListSection::Associations;
+      } else {
+        section = ListSection::Other;
+      }
       continue;
     }
 
-    if (!inSection) {
+    if (section == ListSection::Other) {
       continue;
     }
 
@@ -55,11 +58,20 @@ QHash<QString, QStringList> parseSectionEntries(const QString &filePath,
     }
 
     if (!key.isEmpty()) {
-      result.insert(key, cleaned);
+      (section == ListSection::Defaults ? defaults : associations).insert(key, cleaned);
     }
   }
+}
+
+void parseMimeappsList(const QString &filePath, QHash<QString, QStringList> &defaults,
+                       QHash<QString, QStringList> &associations) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return;
+  }
 
-  return result;
+  QTextStream in(&file);
+  parseMimeappsList(in, defaults, associations);
 }
 
 void mergeAssociations(QHash<QString, QStringList> &target,
@@ -74,51 +86,129 @@ void mergeAssociations(QHash<QString, QStringList> &target,
     }
   }
 }
+
+void collectChangedKeys(const QHash<QString, QStringList> &before,
+                        const QHash<QString, QStringList> &after, QSet<QString> &changed) {
+  for (auto it = before.cbegin(); it != before.cend(); ++it) {
+    const auto match = after.constFind(it.key());
+
+    if (match == after.cend() || match.value() != it.value()) {
+      changed.insert(it.key());
+    }
+  }
+
+  for (auto it = after.cbegin(); it != after.cend(); ++it) {
+    if (!before.contains(it.key())) {
+      changed.insert(it.key());
+    }
+  }
+}
+
+// Moves desktopId to the front of a default list, as the file edit does.
+void applyDefault(QStringList &list, const QString &desktopId) {
+  list.removeAll(desktopId);
+  list.prepend(desktopId);
+}
 } // namespace
 
+MimeDefaultsStore::MimeDefaultsStore(const XdgEnvironment &env) : m_env(env) {
+}
+
+void MimeDefaultsStore::parseContents(const QByteArray &contents,
+                                      QHash<QString, QStringList> &defaults,
+                                      QHash<QString, QStringList> &associations) {
+  QTextStream in(contents);
+  parseMimeappsList(in, defaults, associations);
+}
+
 void MimeDefaultsStore::reload() {
-  m_userDefaults.clear();
+  ALLOCATION_PHASE("MimeDefaultsStore::reload");
+  reloadUserLayer();
+  reloadSystemLayer();
+}
+
+void MimeDefaultsStore::reloadUserLayer() {
+  const ParsedList &parsed = parsedSource(userMimeappsPath());
+  m_userDefaults = parsed.defaults;
+  m_userAssociations = parsed.associations;
+
+  for (const auto &pending : m_pendingUserDefaults) {
+    applyDefault(m_userDefaults[pending.first], pending.second);
+  }
+}
+
+void MimeDefaultsStore::reloadSystemLayer() {
+  // sourceFiles() lists the user file first, then the system lists in precedence order.
+  const QStringList systemFiles = sourceFiles().mid(1);
+  bool changed = !m_systemLayerMerged;
+  for (const QString &filePath : systemFiles) {
+    bool reparsed = false;
+    parsedSource(filePath, &reparsed);
+    changed = changed || reparsed;
+  }
+
+  if (!changed) {
+    return;
+  }
+
   m_systemDefaults.clear();
-  m_userAssociations.clear();
   m_systemAssociations.clear();
 
-  const QString userPath = userMimeappsPath();
-  m_userDefaults = parseSectionEntries(userPath, "Default Applications");
-  m_userAssociations = parseSectionEntries(userPath, "Added Associations");
-
-  const QStringList configDirs = XdgPaths::configDirs();
-  for (const QString &dir : configDirs) {
-    const QString filePath = dir + "/mimeapps.list";
-    const QHash<QString, QStringList> defaults =
-        parseSectionEntries(filePath, "Default Applications");
+  for (const QString &filePath : systemFiles) {
+    const ParsedList &parsed = m_sources[filePath].parsed;
 
-    for (auto it = defaults.begin(); it != defaults.end(); ++it) {
+    for (auto it = parsed.defaults.begin(); it != parsed.defaults.end(); ++it) {
       if (!m_systemDefaults.contains(it.key())) {
         m_systemDefaults.insert(it.key(), it.value());
       }
     }
 
-    const QHash<QString, QStringList> associations =
-        parseSectionEntries(filePath, "Added Associations");
-    mergeAssociations(m_systemAssociations, associations);
+    mergeAssociations(m_systemAssociations, parsed.associations);
   }
 
-  const QStringList dataDirs = XdgPaths::dataDirs();
-  for (const QString &dir : dataDirs) {
-    const QString filePath = dir + "/applications/mimeapps.list";
-    const QHash<QString, QStringList> defaults =
-        parseSectionEntries(filePath, "Default Applications");
+  m_systemLayerMerged = true;
+}
 
-    for (auto it = defaults.begin(); it != defaults.end(); ++it) {
-      if (!m_systemDefaults.contains(it.key())) {
-        m_systemDefaults.insert(it.key(), it.value());
-      }
-    }
+QSet<QString> MimeDefaultsStore::reloadChangedKeys() {
+  const QHash<QString, QStringList> userDefaults = m_userDefaults;
+  const QHash<QString, QStringList> systemDefaults = m_systemDefaults;
+  const QHash<QString, QStringList> userAssociations = m_userAssociations;
+  const QHash<QString, QStringList> systemAssociations = m_systemAssociations;
+
+  reload();
+
+  QSet<QString> changed;
+  collectChangedKeys(userDefaults, m_userDefaults, changed);
+  collectChangedKeys(systemDefaults, m_systemDefaults, changed);
+  collectChangedKeys(userAssociations, m_userAssociations, changed);
+  collectChangedKeys(systemAssociations, m_systemAssociations, changed);
+  return changed;
+}
+
+QStringList MimeDefaultsStore::sourceFiles() const {
+  QStringList files;
+  files.append(userMimeappsPath());
 
-    const QHash<QString, QStringList> associations =
-        parseSectionEntries(filePath, "Added Associations");
-    mergeAssociations(m_systemAssociations, associations);
+  for (const QString &dir : m_env.configDirs()) {
+    files.append(dir + "/mimeapps.list");
   }
+
+  for (const QString &dir : m_env.dataDirs()) {
+    files.append(dir + "/applications/mimeapps.list");
+  }
+
+  return files;
+}
+
+MimeDefaultsStore MimeDefaultsStore::withUserLayer(const XdgEnvironment &env) const {
+  MimeDefaultsStore store(*this);
+  store.m_env = env;
+  store.reloadUserLayer();
+  return store;
+}
+
+const XdgEnvironment &MimeDefaultsStore::environment() const {
+  return m_env;
 }
 
 QHash<QString, QStringList> MimeDefaultsStore::userDefaults() const {
@@ -138,115 +228,52 @@ QHash<QString, QStringList> MimeDefaultsStore::systemAssociations() const {
 }
 
 void MimeDefaultsStore::setUserDefault(const QString &mime, const QString &desktopId) {
-  const QString filePath = userMimeappsPath();
-  QFileInfo info(filePath);
-  QDir().mkpath(info.absolutePath());
-
-  QStringList lines;
-  QFile file(filePath);
-  if (file.exists()) {
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      QTextStream in(&file);
-
-      while (!in.atEnd()) {
-        lines.append(in.readLine());
-      }
-
-      file.close();
+  for (auto &pending : m_pendingUserDefaults) {
+    if (pending.first == mime) {
+      pending.second = desktopId;
+      applyDefault(m_userDefaults[mime], desktopId);
+      return;
     }
   }
 
-  const QString sectionHeader = "[Default Applications]";
-  bool inSection = false;
-  bool foundSection = false;
-  bool updated = false;
-  int insertIndex = -1;
-
-  for (int i = 0; i < lines.size(); ++i) {
-    const QString trimmed = lines[i].trimmed();
-
-    if (trimmed.startsWith('[') && trimmed.endsWith(']')) {
-      if (inSection && !updated && insertIndex == -1) {
-        insertIndex = i;
-      }
-
-      inSection = (trimmed.compare(sectionHeader, Qt::CaseInsensitive) == 0);
-
-      if (inSection) {
-        foundSection = true;
-      }
-      continue;
-    }
-
-    if (!inSection) {
-      continue;
-    }
-
-    if (trimmed.isEmpty() || trimmed.startsWith('#') || trimmed.startsWith(';')) {
-      continue;
-    }
-
-    const int eq = trimmed.indexOf('=');
-    if (eq <= 0) {
-      continue;
-    }
-
-    const QString key = trimmed.left(eq).trimmed();
-    if (key != mime) {
-      continue;
-    }
-
-    QString value = trimmed.mid(eq + 1).trimmed();
-    QStringList items = value.split(';', Qt::SkipEmptyParts);
-    QStringList cleaned;
-    cleaned.append(desktopId);
-
-    for (const QString &item : items) {
-      const QString part = item.trimmed();
-
-      if (!part.isEmpty() && part != desktopId) {
-        cleaned.append(part);
-      }
-    }
+  m_pendingUserDefaults.append(qMakePair(mime, desktopId));
+  applyDefault(m_userDefaults[mime], desktopId);
+}
 
-    QString newValue = cleaned.join(';');
-    if (!newValue.endsWith(';')) {
-      newValue.append(';');
-    }
+QSet<QString> MimeDefaultsStore::settleUserDefaults(const QVector<QPair<QString, QString>> &edits) {
+  m_pendingUserDefaults.erase(std::remove_if(m_pendingUserDefaults.begin(),
+                                             m_pendingUserDefaults.end(),
+                                             [&edits](const QPair<QString, QString> &pending) {
+                                               return edits.contains(pending);
+                                             }),
+                              m_pendingUserDefaults.end());
+  return reloadChangedKeys();
+}
 
-    lines[i] = key + "=" + newValue;
-    updated = true;
-    break;
+const MimeDefaultsStore::ParsedList &MimeDefaultsStore::parsedSource(const QString &path,
+                                                                      bool *reparsed) {
+  const FileStamp stamp = FileStamp::of(path);
+  CachedSource &cached = m_sources[path];
+  const bool stale = cached.stamp != stamp;
+  if (reparsed) {
+    *reparsed = stale;
   }
 
-  if (!foundSection) {
-    if (!lines.isEmpty()) {
-      lines.append("");
-    }
-
-    lines.append(sectionHeader);
-    lines.append(mime + "=" + desktopId + ";");
-  } else if (!updated) {
-    if (insertIndex == -1) {
-      insertIndex = lines.size();
-    }
-
-    lines.insert(insertIndex, mime + "=" + desktopId + ";");
+  if (!stale) {
+    RuntimeCounters::add(RuntimeCounters::MimeappsListsReused);
+    return cached.parsed;
   }
 
-  if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-    QTextStream out(&file);
-
-    for (const QString &line : lines) {
-      out << line << '\n';
-    }
-
-    file.close();
+  cached.stamp = stamp;
+  cached.parsed = ParsedList{};
+  if (stamp.exists) {
+    RuntimeCounters::add(RuntimeCounters::MimeappsListsRead);
+    parseMimeappsList(path, cached.parsed.defaults, cached.parsed.associations);
   }
 
-  reload();
+  return cached.parsed;
 }
 
 QString MimeDefaultsStore::userMimeappsPath() const {
-  return XdgPaths::configHome() + "/mimeapps.list";
+  return m_env.userMimeappsPath();
 }
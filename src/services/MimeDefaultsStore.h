@@ -1,22 +1,68 @@
 #pragma once
 
+#include "utils/FileStamp.h"
+#include "utils/XdgEnvironment.h"
+
+#include <QByteArray>
 #include <QHash>
+#include <QPair>
+#include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
 class MimeDefaultsStore {
 public:
+  explicit MimeDefaultsStore(const XdgEnvironment &env);
+
+  // Parses mimeapps.list contents exactly as reload() parses each file.
+  static void parseContents(const QByteArray &contents, QHash<QString, QStringList> &defaults,
+                            QHash<QString, QStringList> &associations);
+
   void reload();
+  void reloadUserLayer();
+  void reloadSystemLayer();
+  // Reloads every layer and returns the keys whose defaults or added associations differ.
+  QSet<QString> reloadChangedKeys();
+  // Every mimeapps.list the store reads, whether or not it exists yet.
+  QStringList sourceFiles() const;
+  // Copy sharing this store's parsed system layer, with the user layer read from env's home.
+  MimeDefaultsStore withUserLayer(const XdgEnvironment &env) const;
+  const XdgEnvironment &environment() const;
 
   QHash<QString, QStringList> userDefaults() const;
   QHash<QString, QStringList> systemDefaults() const;
   QHash<QString, QStringList> userAssociations() const;
   QHash<QString, QStringList> systemAssociations() const;
 
+  // Updates the in-memory user layer only; the edit stays on top of every reload until
+  // settleUserDefaults() is called for it, so it survives reloads that race the write.
   void setUserDefault(const QString &mime, const QString &desktopId);
+  // Drops the overlay entries matching these (mime, desktop ID) pairs and reloads, returning the
+  // keys that changed as a result (none after a successful write, the reverted ones after a
+  // failed one). A newer edit to the same type is a different pair and stays on top.
+  QSet<QString> settleUserDefaults(const QVector<QPair<QString, QString>> &edits);
   QString userMimeappsPath() const;
 
 private:
+  struct ParsedList {
+    QHash<QString, QStringList> defaults;
+    QHash<QString, QStringList> associations;
+  };
+
+  // A parse stays valid while the file's stamp matches; a missing file is cached too.
+  struct CachedSource {
+    FileStamp stamp;
+    ParsedList parsed;
+  };
+
+  // Returns the memoized parse of path, reparsing it only if its stamp changed.
+  const ParsedList &parsedSource(const QString &path, bool *reparsed = nullptr);
+
+  XdgEnvironment m_env;
+  QVector<QPair<QString, QString>> m_pendingUserDefaults;
+  QHash<QString, CachedSource> m_sources;
+  bool m_systemLayerMerged = false;
   QHash<QString, QStringList> m_userDefaults;
   QHash<QString, QStringList> m_systemDefaults;
   QHash<QString, QStringList> m_userAssociations;
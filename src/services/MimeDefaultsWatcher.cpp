@@ -0,0 +1,66 @@
+#include "services/MimeDefaultsWatcher.h"
+
+#include "services/MimeDefaultsStore.h"
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+namespace {
+// Tools usually write a list in several steps; wait for them to settle before reparsing.
+constexpr int SettleDelayMs = 150;
+} // namespace
+
+MimeDefaultsWatcher::MimeDefaultsWatcher(MimeDefaultsStore *store, QObject *parent)
+    : QObject(parent), m_store(store), m_watcher(new QFileSystemWatcher(this)),
+      m_settleTimer(new QTimer(this)) {
+  m_settleTimer->setSingleShot(true);
+  m_settleTimer->setInterval(SettleDelayMs);
+
+  connect(m_watcher, &QFileSystemWatcher::fileChanged, m_settleTimer,
+          qOverload<>(&QTimer::start));
+  connect(m_watcher, &QFileSystemWatcher::directoryChanged, m_settleTimer,
+          qOverload<>(&QTimer::start));
+  connect(m_settleTimer, &QTimer::timeout, this, &MimeDefaultsWatcher::reloadStore);
+
+  rewatch();
+}
+
+void MimeDefaultsWatcher::rewatch() {
+  // Files replaced by a rename drop out of the watcher, and missing ones cannot be watched at
+  // all, so the parent directories are watched too and the files re-added after each change.
+  const QStringList watchedFiles = m_watcher->files();
+  const QStringList watchedDirs = m_watcher->directories();
+  QStringList files;
+  QStringList dirs;
+
+  for (const QString &path : m_store->sourceFiles()) {
+    const QFileInfo info(path);
+
+    if (info.isFile() && !watchedFiles.contains(path) && !files.contains(path)) {
+      files.append(path);
+    }
+
+    const QString dir = info.absolutePath();
+    if (QFileInfo(dir).isDir() && !watchedDirs.contains(dir) && !dirs.contains(dir)) {
+      dirs.append(dir);
+    }
+  }
+
+  if (!files.isEmpty()) {
+    m_watcher->addPaths(files);
+  }
+
+  if (!dirs.isEmpty()) {
+    m_watcher->addPaths(dirs);
+  }
+}
+
+void MimeDefaultsWatcher::reloadStore() {
+  rewatch();
+
+  const QSet<QString> changed = m_store->reloadChangedKeys();
+  if (!changed.isEmpty()) {
+    emit keysChanged(changed);
+  }
+}
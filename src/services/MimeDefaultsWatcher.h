@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class MimeDefaultsStore;
+class QFileSystemWatcher;
+class QTimer;
+
+// Watches the files a MimeDefaultsStore reads, reloads it when one of them changes and reports
+// only the keys whose values actually differ.
+class MimeDefaultsWatcher : public QObject {
+  Q_OBJECT
+
+public:
+  explicit MimeDefaultsWatcher(MimeDefaultsStore *store, QObject *parent = nullptr);
+
+signals:
+  void keysChanged(const QSet<QString> &keys);
+
+private:
+  void rewatch();
+  void reloadStore();
+
+  MimeDefaultsStore *m_store;
+  QFileSystemWatcher *m_watcher;
+  QTimer *m_settleTimer;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "services/MimeappsDocument.h"
+
+#include <QString>
+
+class AppRegistry;
+
+struct CompactionReport {
+  bool ok = false;
+  QString errorString;
+  qint64 bytesBefore = 0;
+  qint64 bytesAfter = 0;
+  int linesBefore = 0;
+  int linesAfter = 0;
+  qint64 parseNsBefore = 0;
+  qint64 parseNsAfter = 0;
+  MimeappsDocument::CompactionStats stats;
+};
+
+// Prunes a mimeapps.list against the installed applications and rewrites it atomically.
+class MimeappsCompactor {
+public:
+  static CompactionReport compact(const QString &filePath, const AppRegistry &registry,
+                                  bool dryRun = false);
+  static QString summary(const CompactionReport &report);
+};
@@ -0,0 +1,294 @@
+#include "services/MimeappsDocument.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+
+namespace {
+const QString DefaultsSection = QStringLiteral("[Default Applications]");
+
+bool isAssociationSection(const QString &header) {
+  return header.compare(DefaultsSection, Qt::CaseInsensitive) == 0 ||
+         header.compare("[Added Associations]", Qt::CaseInsensitive) == 0 ||
+         header.compare("[Removed Associations]", Qt::CaseInsensitive) == 0;
+}
+
+bool isHeader(const QString &trimmed) {
+  return trimmed.startsWith('[') && trimmed.endsWith(']');
+}
+
+bool isComment(const QString &trimmed) {
+  return trimmed.startsWith('#') || trimmed.startsWith(';');
+}
+
+QString keyOf(const QString &trimmed) {
+  const int eq = trimmed.indexOf('=');
+  return eq > 0 ? trimmed.left(eq).trimmed() : QString();
+}
+} // namespace
+
+bool MimeappsDocument::load(const QString &filePath, QString *errorString) {
+  m_lines.clear();
+
+  QFile file(filePath);
+  if (file.exists()) {
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      if (errorString) {
+        *errorString = file.errorString();
+      }
+      index();
+      return false;
+    }
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+      m_lines.append(Line{in.readLine(), {}});
+    }
+  }
+
+  index();
+  return true;
+}
+
+void MimeappsDocument::setText(const QString &text) {
+  m_lines.clear();
+
+  QStringList lines = text.split('\n');
+  if (!lines.isEmpty() && lines.last().isEmpty()) {
+    lines.removeLast();
+  }
+
+  m_lines.reserve(lines.size());
+  for (QString &line : lines) {
+    if (line.endsWith('\r')) {
+      line.chop(1);
+    }
+    m_lines.append(Line{line, {}});
+  }
+
+  index();
+}
+
+bool MimeappsDocument::save(const QString &filePath, QString *errorString) const {
+  QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+  QSaveFile file(filePath);
+  if (file.open(QIODevice::WriteOnly | QIODevice::Text) && file.write(toString().toUtf8()) >= 0 &&
+      file.commit()) {
+    return true;
+  }
+
+  if (errorString) {
+    *errorString = file.errorString();
+  }
+  return false;
+}
+
+void MimeappsDocument::setDefault(const QString &mime, const QString &desktopId) {
+  const auto it = m_defaultKeys.constFind(mime);
+  if (it != m_defaultKeys.cend()) {
+    QString &text = lineText(it.value());
+    const QString trimmed = text.trimmed();
+    const QStringList items = trimmed.mid(trimmed.indexOf('=') + 1).split(';', Qt::SkipEmptyParts);
+
+    QStringList cleaned;
+    cleaned.append(desktopId);
+    for (const QString &item : items) {
+      const QString part = item.trimmed();
+
+      if (!part.isEmpty() && part != desktopId) {
+        cleaned.append(part);
+      }
+    }
+
+    text = mime + "=" + cleaned.join(';') + ";";
+    return;
+  }
+
+  if (m_defaultsAnchor < 0) {
+    if (!m_lines.isEmpty()) {
+      m_lines.append(Line{QString(), {}});
+    }
+
+    m_lines.append(Line{DefaultsSection, {}});
+    m_defaultsAnchor = static_cast<int>(m_lines.size()) - 1;
+  }
+
+  QStringList &appended = m_lines[m_defaultsAnchor].appended;
+  appended.append(mime + "=" + desktopId + ";");
+  m_defaultKeys.insert(mime, qMakePair(m_defaultsAnchor, static_cast<int>(appended.size()) - 1));
+}
+
+MimeappsDocument::CompactionStats
+MimeappsDocument::compact(const std::function<bool(const QString &)> &isInstalled) {
+  QStringList lines;
+  for (const Line &line : m_lines) {
+    lines.append(line.text);
+    lines.append(line.appended);
+  }
+
+  // Repeated section headers continue the same section, so occurrences are keyed by the
+  // section name and the last one of each key wins.
+  QHash<QString, int> lastOccurrence;
+  QString section;
+  for (int i = 0; i < lines.size(); ++i) {
+    const QString trimmed = lines[i].trimmed();
+
+    if (isHeader(trimmed)) {
+      section = isAssociationSection(trimmed) ? trimmed.toLower() : QString();
+    } else if (!section.isEmpty() && !trimmed.isEmpty() && !isComment(trimmed)) {
+      const QString key = keyOf(trimmed);
+      if (!key.isEmpty()) {
+        lastOccurrence.insert(section + '\n' + key, i);
+      }
+    }
+  }
+
+  CompactionStats stats;
+  QStringList output;
+  int headerLine = -1;
+  int keysInSection = 0;
+  bool inAssociations = false;
+
+  // Drops the current association section if nothing but blank lines is left in it.
+  const auto closeSection = [&]() {
+    if (!inAssociations || keysInSection > 0) {
+      return;
+    }
+
+    QStringList kept;
+    for (int i = headerLine + 1; i < output.size(); ++i) {
+      if (!output[i].trimmed().isEmpty()) {
+        kept.append(output[i]);
+      }
+    }
+
+    output.erase(output.begin() + headerLine, output.end());
+    output.append(kept);
+    ++stats.removedSections;
+  };
+
+  for (int i = 0; i < lines.size(); ++i) {
+    const QString &line = lines[i];
+    const QString trimmed = line.trimmed();
+
+    if (isHeader(trimmed)) {
+      closeSection();
+      inAssociations = isAssociationSection(trimmed);
+      section = inAssociations ? trimmed.toLower() : QString();
+      headerLine = static_cast<int>(output.size());
+      keysInSection = 0;
+      output.append(line);
+      continue;
+    }
+
+    const QString key = inAssociations && !isComment(trimmed) ? keyOf(trimmed) : QString();
+    if (key.isEmpty()) {
+      output.append(line);
+      continue;
+    }
+
+    if (lastOccurrence.value(section + '\n' + key) != i) {
+      ++stats.mergedDuplicates;
+      continue;
+    }
+
+    const QStringList items =
+        trimmed.mid(trimmed.indexOf('=') + 1).split(';', Qt::SkipEmptyParts);
+    QStringList ids;
+    for (const QString &item : items) {
+      const QString id = item.trimmed();
+
+      if (id.isEmpty()) {
+        continue;
+      }
+
+      if (ids.contains(id)) {
+        ++stats.mergedDuplicates;
+      } else if (!isInstalled(id)) {
+        ++stats.removedIds;
+      } else {
+        ids.append(id);
+      }
+    }
+
+    if (ids.isEmpty()) {
+      ++stats.removedKeys;
+      continue;
+    }
+
+    ++keysInSection;
+    output.append(ids.size() == items.size() ? line : key + "=" + ids.join(';') + ";");
+  }
+  closeSection();
+
+  m_lines.clear();
+  m_lines.reserve(output.size());
+  for (const QString &line : output) {
+    m_lines.append(Line{line, {}});
+  }
+
+  index();
+  return stats;
+}
+
+QString MimeappsDocument::toString() const {
+  QString text;
+  for (const Line &line : m_lines) {
+    text += line.text;
+    text += '\n';
+
+    for (const QString &extra : line.appended) {
+      text += extra;
+      text += '\n';
+    }
+  }
+
+  return text;
+}
+
+void MimeappsDocument::index() {
+  m_defaultsAnchor = -1;
+  m_defaultKeys.clear();
+
+  // Keys are indexed to their last occurrence, which is the one readers honour. New keys go
+  // to the end of the first [Default Applications] section, before the next header.
+  bool inSection = false;
+  bool inFirstSection = false;
+  for (int i = 0; i < m_lines.size(); ++i) {
+    const QString trimmed = m_lines[i].text.trimmed();
+
+    if (trimmed.startsWith('[') && trimmed.endsWith(']')) {
+      inSection = trimmed.compare(DefaultsSection, Qt::CaseInsensitive) == 0;
+      inFirstSection = inSection && m_defaultsAnchor < 0;
+      if (inFirstSection) {
+        m_defaultsAnchor = i;
+      }
+      continue;
+    }
+
+    if (inFirstSection) {
+      m_defaultsAnchor = i;
+    }
+
+    if (!inSection) {
+      continue;
+    }
+
+    if (trimmed.isEmpty() || trimmed.startsWith('#') || trimmed.startsWith(';')) {
+      continue;
+    }
+
+    const int eq = trimmed.indexOf('=');
+    if (eq > 0) {
+      m_defaultKeys.insert(trimmed.left(eq).trimmed(), qMakePair(i, -1));
+    }
+  }
+}
+
+QString &MimeappsDocument::lineText(const QPair<int, int> &location) {
+  Line &line = m_lines[location.first];
+  return location.second < 0 ? line.text : line.appended[location.second];
+}
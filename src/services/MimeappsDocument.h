@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+// Editable copy of a mimeapps.list that keeps every line it does not touch, comments and
+// unknown sections included. Keys of [Default Applications] are indexed to their line, so an
+// edit is a hash lookup and a commit is a single serialization.
+class MimeappsDocument {
+public:
+  struct CompactionStats {
+    int mergedDuplicates = 0;
+    int removedIds = 0;
+    int removedKeys = 0;
+    int removedSections = 0;
+  };
+
+  // A missing file loads as an empty document.
+  bool load(const QString &filePath, QString *errorString = nullptr);
+  bool save(const QString &filePath, QString *errorString = nullptr) const;
+  void setText(const QString &text);
+
+  // Rewrites the association sections: repeated keys collapse into the occurrence readers
+  // honour, IDs failing isInstalled are dropped (in every section, [Removed Associations]
+  // included), and keys and sections left empty go too.
+  // Comments and unknown sections are kept.
+  CompactionStats compact(const std::function<bool(const QString &)> &isInstalled);
+
+  // Moves desktopId to the front of mime's default list, adding the key or section as needed.
+  void setDefault(const QString &mime, const QString &desktopId);
+  QString toString() const;
+
+private:
+  // New keys are attached to the last line of their section instead of being inserted into
+  // the vector, which keeps edits constant time.
+  struct Line {
+    QString text;
+    QStringList appended;
+  };
+
+  void index();
+  QString &lineText(const QPair<int, int> &location);
+
+  QVector<Line> m_lines;
+  int m_defaultsAnchor = -1;
+  QHash<QString, QPair<int, int>> m_defaultKeys;
+};
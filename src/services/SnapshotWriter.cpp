@@ -0,0 +1,73 @@
+#include "services/SnapshotWriter.h"
+
+#include "services/AppRegistry.h"
+#include "services/EntrySnapshot.h"
+#include "services/MimeAssociationService.h"
+#include "services/MimeDefaultsStore.h"
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QTimer>
+
+namespace {
+Q_LOGGING_CATEGORY(lcSnapshotWriter, "mime-settings.snapshot.writer", QtWarningMsg)
+
+// Watcher refreshes and commits tend to come in bursts; one build covers the lot.
+constexpr int CoalesceDelayMs = 500;
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const XdgEnvironment &env, QObject *parent)
+    : QObject(parent), m_env(env), m_context(new QObject) {
+  m_thread.setObjectName("SnapshotWriter");
+  m_context->moveToThread(&m_thread);
+  m_thread.start(QThread::LowPriority);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  // A build in progress finishes; a scheduled one is dropped with the event loop.
+  m_thread.quit();
+  m_thread.wait();
+  delete m_context;
+}
+
+void SnapshotWriter::request() {
+  QMutexLocker locker(&m_mutex);
+  if (m_scheduled) {
+    return;
+  }
+
+  m_scheduled = true;
+  if (!m_building) {
+    QTimer::singleShot(CoalesceDelayMs, m_context, [this]() { build(); });
+  }
+}
+
+void SnapshotWriter::build() {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_scheduled = false;
+    m_building = true;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // The fingerprint is taken first, so anything that changes during the build leaves a
+  // snapshot that simply fails to match next time.
+  const QByteArray fingerprint = EntrySnapshot::fingerprint(m_env);
+  AppRegistry registry(m_env);
+  registry.load();
+  MimeDefaultsStore store(m_env);
+  store.reload();
+  const QVector<MimeEntry> entries = MimeAssociationService(&registry, &store).buildEntries();
+  const bool ok = EntrySnapshot::write(EntrySnapshot::defaultPath(m_env), fingerprint, entries);
+  qCDebug(lcSnapshotWriter) << (ok ? "wrote" : "could not write") << "snapshot in"
+                            << timer.nsecsElapsed() / 1000 << "us";
+
+  QMutexLocker locker(&m_mutex);
+  m_building = false;
+  if (m_scheduled) {
+    QTimer::singleShot(CoalesceDelayMs, m_context, [this]() { build(); });
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "utils/XdgEnvironment.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+
+// Rebuilds the entry snapshot on a dedicated thread. Every build resolves from a registry and
+// store of its own read from disk, so it sees committed defaults only, never the GUI's overlay;
+// requests made while a build runs fold into a single follow-up build.
+class SnapshotWriter : public QObject {
+  Q_OBJECT
+
+public:
+  explicit SnapshotWriter(const XdgEnvironment &env, QObject *parent = nullptr);
+  ~SnapshotWriter() override;
+
+  void request();
+
+private:
+  void build();
+
+  XdgEnvironment m_env;
+  QThread m_thread;
+  QObject *m_context;
+  QMutex m_mutex;
+  bool m_scheduled = false;
+  bool m_building = false;
+};
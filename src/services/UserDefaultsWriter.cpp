@@ -0,0 +1,105 @@
+#include "services/UserDefaultsWriter.h"
+
+#include <QMutexLocker>
+#include <QTimer>
+
+namespace {
+// Long enough to fold a burst of clicks into one commit, short enough to feel immediate.
+constexpr int CoalesceDelayMs = 250;
+} // namespace
+
+UserDefaultsWriter::UserDefaultsWriter(const QString &filePath, QObject *parent)
+    : QObject(parent), m_filePath(filePath), m_context(new QObject) {
+  m_thread.setObjectName("UserDefaultsWriter");
+  m_context->moveToThread(&m_thread);
+  m_thread.start();
+}
+
+UserDefaultsWriter::~UserDefaultsWriter() {
+  flush();
+  m_thread.quit();
+  m_thread.wait();
+  delete m_context;
+}
+
+void UserDefaultsWriter::enqueue(const QString &mime, const QString &desktopId) {
+  enqueue(QVector<QPair<QString, QString>>{qMakePair(mime, desktopId)});
+}
+
+void UserDefaultsWriter::enqueue(const QVector<QPair<QString, QString>> &edits) {
+  QMutexLocker locker(&m_mutex);
+
+  for (const auto &edit : edits) {
+    bool replaced = false;
+    for (auto &pending : m_pending) {
+      if (pending.first == edit.first) {
+        pending.second = edit.second;
+        replaced = true;
+        break;
+      }
+    }
+
+    if (!replaced) {
+      m_pending.append(edit);
+    }
+  }
+
+  if (!m_scheduled) {
+    m_scheduled = true;
+    QTimer::singleShot(CoalesceDelayMs, m_context, [this]() { commitPending(); });
+  }
+}
+
+void UserDefaultsWriter::flush() {
+  if (!m_thread.isRunning()) {
+    return;
+  }
+
+  QMetaObject::invokeMethod(m_context, [this]() { commitPending(); },
+                            Qt::BlockingQueuedConnection);
+}
+
+void UserDefaultsWriter::commitPending() {
+  QVector<QPair<QString, QString>> edits;
+  {
+    QMutexLocker locker(&m_mutex);
+    edits.swap(m_pending);
+    m_scheduled = false;
+  }
+
+  if (edits.isEmpty()) {
+    return;
+  }
+
+  QString errorString;
+  bool ok = loadDocumentIfChanged(&errorString);
+  if (ok) {
+    for (const auto &edit : edits) {
+      m_document.setDefault(edit.first, edit.second);
+    }
+
+    ok = m_document.save(m_filePath, &errorString);
+  }
+
+  // After a failure the document may hold edits the file does not; start over next time.
+  if (ok) {
+    m_documentStamp = FileStamp::of(m_filePath);
+  } else {
+    m_documentLoaded = false;
+  }
+
+  emit committed(edits, ok, errorString);
+}
+
+bool UserDefaultsWriter::loadDocumentIfChanged(QString *errorString) {
+  // Same stamp as MimeDefaultsStore: a millisecond mtime misses two writes within one
+  // millisecond, and an editor's atomic replace can keep the size.
+  const FileStamp stamp = FileStamp::of(m_filePath);
+  if (m_documentLoaded && stamp == m_documentStamp) {
+    return true;
+  }
+
+  m_documentLoaded = m_document.load(m_filePath, errorString);
+  m_documentStamp = stamp;
+  return m_documentLoaded;
+}
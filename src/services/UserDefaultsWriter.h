@@ -0,0 +1,48 @@
+#pragma once
+
+#include "services/MimeappsDocument.h"
+#include "utils/FileStamp.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+// Write-behind for the user's mimeapps.list. Edits are queued from the GUI thread and
+// committed on a dedicated thread; edits that arrive while one is pending share its commit.
+class UserDefaultsWriter : public QObject {
+  Q_OBJECT
+
+public:
+  explicit UserDefaultsWriter(const QString &filePath, QObject *parent = nullptr);
+  ~UserDefaultsWriter() override;
+
+  void enqueue(const QString &mime, const QString &desktopId);
+  // Queues edits as one unit; they are never split across commits.
+  void enqueue(const QVector<QPair<QString, QString>> &edits);
+  // Blocks until every queued edit has been written.
+  void flush();
+
+signals:
+  // Delivered on the thread that owns the writer, with the (mime, desktop ID) pairs written.
+  void committed(const QVector<QPair<QString, QString>> &edits, bool ok,
+                 const QString &errorString);
+
+private:
+  void commitPending();
+  bool loadDocumentIfChanged(QString *errorString);
+
+  QString m_filePath;
+  // Owned by the writer thread. Reloaded only when someone else changed the file.
+  MimeappsDocument m_document;
+  bool m_documentLoaded = false;
+  FileStamp m_documentStamp;
+  QThread m_thread;
+  QObject *m_context;
+  QMutex m_mutex;
+  QVector<QPair<QString, QString>> m_pending;
+  bool m_scheduled = false;
+};
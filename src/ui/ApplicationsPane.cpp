@@ -0,0 +1,97 @@
+#include "ui/ApplicationsPane.h"
+
+#include "services/AppRegistry.h"
+#include "services/AppTypeIndex.h"
+#include "utils/RuntimeCounters.h"
+
+#include <QAbstractItemView>
+#include <QIcon>
+#include <QLabel>
+#include <QListWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+ApplicationsPane::ApplicationsPane(AppRegistry *registry, const AppTypeIndex *index,
+                                   QWidget *parent)
+    : QWidget(parent), m_registry(registry), m_index(index) {
+  m_apps = new QListWidget(this);
+  m_apps->setObjectName("ApplicationsList");
+  m_apps->setSelectionMode(QAbstractItemView::SingleSelection);
+
+  m_defaultsLabel = new QLabel(this);
+  m_defaultsLabel->setObjectName("HeaderLabel");
+  m_defaults = new QListWidget(this);
+  m_defaults->setObjectName("AppDefaultsList");
+
+  m_handledLabel = new QLabel(this);
+  m_handledLabel->setObjectName("HeaderLabel");
+  m_handled = new QListWidget(this);
+  m_handled->setObjectName("AppTypesList");
+
+  auto *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(8, 8, 8, 8);
+  layout->setSpacing(6);
+  layout->addWidget(m_apps, 2);
+  layout->addWidget(m_defaultsLabel);
+  layout->addWidget(m_defaults, 1);
+  layout->addWidget(m_handledLabel);
+  layout->addWidget(m_handled, 1);
+
+  connect(m_apps, &QListWidget::currentItemChanged, this,
+          &ApplicationsPane::refreshSelection);
+  connect(m_defaults, &QListWidget::itemActivated, this, &ApplicationsPane::onTypeActivated);
+  connect(m_handled, &QListWidget::itemActivated, this, &ApplicationsPane::onTypeActivated);
+
+  refreshSelection();
+}
+
+void ApplicationsPane::reloadApps() {
+  const QListWidgetItem *current = m_apps->currentItem();
+  const QString currentId = current ? current->data(Qt::UserRole).toString() : QString();
+
+  QList<AppInfo> apps = m_registry->allApps();
+  std::sort(apps.begin(), apps.end(), [](const AppInfo &a, const AppInfo &b) {
+    return QString::localeAwareCompare(a.name, b.name) < 0;
+  });
+
+  m_apps->clear();
+  for (const AppInfo &app : apps) {
+    auto *item = new QListWidgetItem(app.name, m_apps);
+    item->setData(Qt::UserRole, app.desktopId);
+    item->setToolTip(app.desktopId);
+
+    RuntimeCounters::add(RuntimeCounters::IconLookups);
+    item->setIcon(QIcon::fromTheme(app.iconName.isEmpty() ? "application-x-executable"
+                                                          : app.iconName));
+
+    if (app.desktopId == currentId) {
+      m_apps->setCurrentItem(item);
+    }
+  }
+
+  refreshSelection();
+}
+
+void ApplicationsPane::refreshSelection() {
+  const QListWidgetItem *current = m_apps->currentItem();
+  const QString id = current ? current->data(Qt::UserRole).toString() : QString();
+
+  fillTypes(m_defaults, m_defaultsLabel, "Default for",
+            id.isEmpty() ? QStringList() : m_index->typesDefaultingTo(id));
+  fillTypes(m_handled, m_handledLabel, "Can open",
+            id.isEmpty() ? QStringList() : m_index->typesHandledBy(id));
+}
+
+void ApplicationsPane::onTypeActivated(QListWidgetItem *item) {
+  if (item) {
+    emit typeActivated(item->text());
+  }
+}
+
+void ApplicationsPane::fillTypes(QListWidget *list, QLabel *label, const QString &title,
+                                 const QStringList &types) {
+  label->setText(QString("%1 (%2)").arg(title).arg(types.size()));
+  list->clear();
+  list->addItems(types);
+}
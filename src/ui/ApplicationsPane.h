@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QString>
+#include <QWidget>
+
+class AppRegistry;
+class AppTypeIndex;
+class QLabel;
+class QListWidget;
+class QListWidgetItem;
+
+// Application-centric view: every installed application, and for the selected one the types
+// it is the default for and the types it can open, read from an AppTypeIndex.
+class ApplicationsPane : public QWidget {
+  Q_OBJECT
+
+public:
+  ApplicationsPane(AppRegistry *registry, const AppTypeIndex *index, QWidget *parent = nullptr);
+
+  // Lists the registry's applications again, keeping the current one selected.
+  void reloadApps();
+  // Re-reads the selected application's types after the index changed.
+  void refreshSelection();
+
+signals:
+  void typeActivated(const QString &mime);
+
+private slots:
+  void onTypeActivated(QListWidgetItem *item);
+
+private:
+  void fillTypes(QListWidget *list, QLabel *label, const QString &title, const QStringList &types);
+
+  AppRegistry *m_registry;
+  const AppTypeIndex *m_index;
+
+  QListWidget *m_apps;
+  QLabel *m_defaultsLabel;
+  QListWidget *m_defaults;
+  QLabel *m_handledLabel;
+  QListWidget *m_handled;
+};
@@ -1,6 +1,7 @@
 #include "ui/DetailsPane.h"
 
 #include "services/AppRegistry.h"
+#include "utils/RuntimeCounters.h"
 
 #include <QAbstractItemView>
 #include <QFont>
@@ -48,6 +49,16 @@ DetailsPane::DetailsPane(AppRegistry *registry, QWidget *parent)
   m_setDefault = new QPushButton("Set as default", this);
   m_setDefault->setEnabled(false);
 
+  m_setDefaultForApp = new QPushButton("Default for its types...", this);
+  m_setDefaultForApp->setToolTip("Make the selected application the default for every type it "
+                                 "supports, or a filtered subset of them");
+  m_setDefaultForApp->setEnabled(false);
+
+  auto *buttonRow = new QHBoxLayout();
+  buttonRow->addStretch(1);
+  buttonRow->addWidget(m_setDefaultForApp);
+  buttonRow->addWidget(m_setDefault);
+
   auto *defaultRow = new QHBoxLayout();
   defaultRow->addWidget(m_defaultIcon);
   defaultRow->addWidget(m_defaultName, 1);
@@ -67,13 +78,15 @@ DetailsPane::DetailsPane(AppRegistry *registry, QWidget *parent)
   layout->addWidget(m_associations, 1);
   layout->addWidget(m_emptyHint);
   layout->addSpacing(8);
-  layout->addWidget(m_setDefault, 0, Qt::AlignRight);
+  layout->addLayout(buttonRow);
   layout->setContentsMargins(16, 16, 16, 16);
   layout->setSpacing(8);
 
   connect(m_associations, &QListWidget::itemSelectionChanged, this,
           &DetailsPane::updateButtonState);
   connect(m_setDefault, &QPushButton::clicked, this, &DetailsPane::onSetDefaultClicked);
+  connect(m_setDefaultForApp, &QPushButton::clicked, this,
+          &DetailsPane::onSetDefaultForAppClicked);
 }
 
 void DetailsPane::setEntry(const MimeEntry &entry) {
@@ -104,6 +117,7 @@ void DetailsPane::updateDefaultDisplay() {
   m_defaultName->setText(name);
 
   const QString iconName = app ? app->iconName : QString();
+  RuntimeCounters::add(RuntimeCounters::IconLookups);
   QIcon icon = QIcon::fromTheme(iconName.isEmpty() ? "application-x-executable" : iconName);
   m_defaultIcon->setPixmap(icon.pixmap(32, 32));
 }
@@ -119,6 +133,7 @@ void DetailsPane::updateAssociations() {
     item->setData(Qt::UserRole, appId);
 
     const QString iconName = app ? app->iconName : QString();
+    RuntimeCounters::add(RuntimeCounters::IconLookups);
     QIcon icon = QIcon::fromTheme(
 
         iconName.isEmpty() ? "application-x-executable" : iconName);
@@ -154,12 +169,14 @@ void DetailsPane::updateButtonState() {
 
   if (!item) {
     m_setDefault->setEnabled(false);
+    m_setDefaultForApp->setEnabled(false);
     return;
   }
 
   const QString selectedId = item->data(Qt::UserRole).toString();
   const bool canSet = !selectedId.isEmpty() && selectedId != m_entry.defaultAppId;
   m_setDefault->setEnabled(canSet);
+  m_setDefaultForApp->setEnabled(!selectedId.isEmpty() && m_registry->findById(selectedId));
 }
 
 void DetailsPane::onSetDefaultClicked() {
@@ -176,3 +193,15 @@ void DetailsPane::onSetDefaultClicked() {
 
   emit requestSetDefault(m_entry.mimeType, selectedId);
 }
+
+void DetailsPane::onSetDefaultForAppClicked() {
+  const QListWidgetItem *item = m_associations->currentItem();
+  if (!item) {
+    return;
+  }
+
+  const QString selectedId = item->data(Qt::UserRole).toString();
+  if (!selectedId.isEmpty()) {
+    emit requestSetDefaultForApp(selectedId);
+  }
+}
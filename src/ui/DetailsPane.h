@@ -20,10 +20,12 @@ public:
 
 signals:
   void requestSetDefault(const QString &mime, const QString &desktopId);
+  void requestSetDefaultForApp(const QString &desktopId);
 
 private slots:
   void updateButtonState();
   void onSetDefaultClicked();
+  void onSetDefaultForAppClicked();
 
 private:
   void updateDefaultDisplay();
@@ -39,4 +41,5 @@ private:
   QListWidget *m_associations;
   QLabel *m_emptyHint;
   QPushButton *m_setDefault;
+  QPushButton *m_setDefaultForApp;
 };
@@ -0,0 +1,58 @@
+#include "ui/DiagnosticsPanel.h"
+
+#include "utils/RuntimeCounters.h"
+
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+namespace {
+constexpr int RefreshIntervalMs = 500;
+} // namespace
+
+DiagnosticsPanel::DiagnosticsPanel(QWidget *parent)
+    : QWidget(parent), m_table(new QTableWidget(RuntimeCounters::CounterCount, 2, this)),
+      m_refreshTimer(new QTimer(this)) {
+  m_table->setObjectName("DiagnosticsTable");
+  m_table->setHorizontalHeaderLabels({"Counter", "Value"});
+  m_table->verticalHeader()->hide();
+  m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+  m_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+  m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_table->setSelectionMode(QAbstractItemView::NoSelection);
+
+  for (int i = 0; i < RuntimeCounters::CounterCount; ++i) {
+    const auto counter = static_cast<RuntimeCounters::Counter>(i);
+    m_table->setItem(i, 0, new QTableWidgetItem(RuntimeCounters::name(counter)));
+
+    auto *value = new QTableWidgetItem;
+    value->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    m_table->setItem(i, 1, value);
+  }
+
+  auto *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(m_table);
+
+  m_refreshTimer->setInterval(RefreshIntervalMs);
+  connect(m_refreshTimer, &QTimer::timeout, this, &DiagnosticsPanel::refresh);
+}
+
+void DiagnosticsPanel::showEvent(QShowEvent *event) {
+  QWidget::showEvent(event);
+  refresh();
+  m_refreshTimer->start();
+}
+
+void DiagnosticsPanel::hideEvent(QHideEvent *event) {
+  QWidget::hideEvent(event);
+  m_refreshTimer->stop();
+}
+
+void DiagnosticsPanel::refresh() {
+  for (int i = 0; i < RuntimeCounters::CounterCount; ++i) {
+    const auto counter = static_cast<RuntimeCounters::Counter>(i);
+    m_table->item(i, 1)->setText(RuntimeCounters::formattedValue(counter));
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QWidget>
+
+class QTableWidget;
+class QTimer;
+
+// Live view of RuntimeCounters. Polls only while shown, so a hidden panel costs nothing.
+class DiagnosticsPanel : public QWidget {
+  Q_OBJECT
+
+public:
+  explicit DiagnosticsPanel(QWidget *parent = nullptr);
+
+protected:
+  void showEvent(QShowEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
+
+private slots:
+  void refresh();
+
+private:
+  QTableWidget *m_table;
+  QTimer *m_refreshTimer;
+};
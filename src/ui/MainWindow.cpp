@@ -1,42 +1,63 @@
 #include "ui/MainWindow.h"
 
+#include "PaletteData.h"
 #include "models/MimeTypeFilterProxy.h"
 #include "models/MimeTypeModel.h"
+#include "services/EntrySnapshot.h"
+#include "services/MimeDefaultsWatcher.h"
+#include "services/MimeappsCompactor.h"
+#include "services/SnapshotWriter.h"
+#include "services/UserDefaultsWriter.h"
+#include "ui/ApplicationsPane.h"
 #include "ui/DetailsPane.h"
-#include "utils/XdgPaths.h"
+#include "ui/DiagnosticsPanel.h"
+#include "ui/MimeTreeDelegate.h"
+#include "utils/RuntimeCounters.h"
 
 #include <QAbstractItemView>
 #include <QColor>
 #include <QComboBox>
 #include <QDir>
+#include <QDockWidget>
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QElapsedTimer>
 #include <QEvent>
-#include <QFile>
+#include <QFileInfo>
 #include <QFont>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QIcon>
+#include <QInputDialog>
 #include <QItemSelectionModel>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonParseError>
 #include <QLabel>
 #include <QLineEdit>
+#include <QLoggingCategory>
+#include <QMessageBox>
+#include <QMimeData>
+#include <QMimeDatabase>
 #include <QPainter>
 #include <QPainterPath>
-#include <QPair>
+#include <QPalette>
 #include <QPen>
 #include <QPixmap>
+#include <QPushButton>
 #include <QSettings>
 #include <QSignalBlocker>
 #include <QSplitter>
 #include <QStatusBar>
+#include <QTimer>
 #include <QTreeView>
+#include <QUrl>
 #include <QVBoxLayout>
 
 #include <algorithm>
 #include <cmath>
 
 namespace {
+Q_LOGGING_CATEGORY(lcTheme, "mime-settings.theme", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcSnapshot, "mime-settings.snapshot", QtWarningMsg)
+
 QIcon makeEmojiIcon(const QString &emoji) {
   const int size = 18;
   QPixmap pixmap(size, size);
@@ -76,15 +97,71 @@ QColor blendColors(const QColor &top, const QColor &bottom, double alpha) {
   return QColor(mix(top.red(), bottom.red()), mix(top.green(), bottom.green()),
                 mix(top.blue(), bottom.blue()));
 }
+
+const palette::Theme *findTheme(const QString &id) {
+  for (const palette::Theme &theme : palette::kThemes) {
+    if (id == QLatin1String(theme.id)) {
+      return &theme;
+    }
+  }
+
+  return nullptr;
+}
+
+const palette::Color *findColor(const palette::Theme &theme, const QString &id) {
+  for (std::size_t i = 0; i < theme.colorCount; ++i) {
+    if (id == QLatin1String(theme.colors[i].id)) {
+      return &theme.colors[i];
+    }
+  }
+
+  return nullptr;
+}
+
+const palette::Theme &defaultTheme() {
+  const palette::Theme *mocha = findTheme("mocha");
+  return mocha ? *mocha : palette::kThemes[0];
+}
 } // namespace
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_service(&m_registry, &m_store) {
+MainWindow::MainWindow(const XdgEnvironment &env, QWidget *parent)
+    : QMainWindow(parent), m_env(env), m_registry(m_env), m_store(m_env),
+      m_service(&m_registry, &m_store),
+      m_writer(new UserDefaultsWriter(m_store.userMimeappsPath(), this)),
+      m_snapshotWriter(new SnapshotWriter(m_env, this)) {
+  QElapsedTimer timer;
+  timer.start();
+  m_snapshot = EntrySnapshot::open(EntrySnapshot::defaultPath(m_env),
+                                   EntrySnapshot::fingerprint(m_env));
+  RuntimeCounters::add(m_snapshot ? RuntimeCounters::SnapshotHits
+                                  : RuntimeCounters::SnapshotMisses);
+  qCDebug(lcSnapshot) << (m_snapshot ? "opened" : "no usable snapshot") << "in"
+                      << timer.nsecsElapsed() / 1000 << "us";
+
+  // Rows come from the snapshot on a warm start; the registry is still needed for application
+  // names and icons, but the store is first read by an edit or a live resolution, so its parse
+  // waits until the window has painted.
   m_registry.load();
-  m_store.reload();
-  loadPalette();
+  if (m_snapshot) {
+    QTimer::singleShot(0, this, [this]() { m_store.reload(); });
+  } else {
+    m_store.reload();
+  }
+
   loadAppearanceSettings();
   buildUi();
   loadData();
+
+  auto *watcher = new MimeDefaultsWatcher(&m_store, this);
+  connect(watcher, &MimeDefaultsWatcher::keysChanged, this, &MainWindow::onDefaultsChanged);
+  connect(m_writer, &UserDefaultsWriter::committed, this, &MainWindow::onDefaultsCommitted);
+
+  if (!m_snapshot) {
+    m_snapshotWriter->request();
+  }
+
+  qCDebug(lcSnapshot) << (m_snapshot ? "warm" : "cold") << "start ready to paint in"
+                      << timer.nsecsElapsed() / 1000 << "us";
 }
 
 void MainWindow::buildUi() {
@@ -98,6 +175,7 @@ void MainWindow::buildUi() {
 
   auto *header = new QWidget(content);
   header->setObjectName("AppHeader");
+  m_header = header;
   auto *headerLayout = new QHBoxLayout(header);
   headerLayout->setContentsMargins(14, 10, 14, 10);
   headerLayout->setSpacing(10);
@@ -109,6 +187,22 @@ void MainWindow::buildUi() {
   headerFont.setBold(true);
   headerTitle->setFont(headerFont);
 
+  auto *compactButton = new QPushButton("Compact list...", header);
+  compactButton->setObjectName("CompactButton");
+  compactButton->setToolTip("Remove uninstalled applications, duplicate keys and empty sections "
+                            "from your mimeapps.list");
+  connect(compactButton, &QPushButton::clicked, this, &MainWindow::onCompactRequested);
+
+  auto *appsButton = new QPushButton("Applications", header);
+  appsButton->setObjectName("ApplicationsButton");
+  appsButton->setCheckable(true);
+  appsButton->setToolTip("Show what each application opens and where it is the default");
+
+  auto *diagnosticsButton = new QPushButton("Diagnostics", header);
+  diagnosticsButton->setObjectName("DiagnosticsButton");
+  diagnosticsButton->setCheckable(true);
+  diagnosticsButton->setToolTip("Show cache, parse and resolution counters for this session");
+
   auto *themeLabel = new QLabel("Theme", header);
   themeLabel->setObjectName("HeaderLabel");
   m_themePicker = new QComboBox(header);
@@ -123,6 +217,10 @@ void MainWindow::buildUi() {
 
   headerLayout->addWidget(headerTitle);
   headerLayout->addStretch(1);
+  headerLayout->addWidget(compactButton);
+  headerLayout->addWidget(appsButton);
+  headerLayout->addWidget(diagnosticsButton);
+  headerLayout->addSpacing(6);
   headerLayout->addWidget(themeLabel);
   headerLayout->addWidget(m_themePicker);
   headerLayout->addSpacing(6);
@@ -162,6 +260,10 @@ void MainWindow::buildUi() {
   m_table->setItemsExpandable(true);
   m_table->setExpandsOnDoubleClick(true);
   m_table->viewport()->installEventFilter(this);
+  m_table->viewport()->setAttribute(Qt::WA_Hover);
+  m_table->setMouseTracking(true);
+  m_treeDelegate = new MimeTreeDelegate(m_table);
+  m_table->setItemDelegate(m_treeDelegate);
 
   leftLayout->addWidget(m_search);
   leftLayout->addWidget(m_table, 1);
@@ -177,8 +279,39 @@ void MainWindow::buildUi() {
   contentLayout->addWidget(splitter, 1);
   setCentralWidget(content);
   setStatusBar(new QStatusBar(this));
-
-  m_model = new MimeTypeModel(&m_registry, this);
+  setAcceptDrops(true);
+
+  auto *appsDock = new QDockWidget("Applications", this);
+  appsDock->setObjectName("ApplicationsDock");
+  m_appsPane = new ApplicationsPane(&m_registry, &m_appIndex, appsDock);
+  appsDock->setWidget(m_appsPane);
+  addDockWidget(Qt::RightDockWidgetArea, appsDock);
+  appsDock->hide();
+  m_appsDock = appsDock;
+  connect(appsButton, &QPushButton::toggled, appsDock, [this, appsDock](bool checked) {
+    if (checked) {
+      ensureAppIndex();
+    }
+    appsDock->setVisible(checked);
+  });
+  connect(appsDock, &QDockWidget::visibilityChanged, appsButton, [appsButton, appsDock](bool) {
+    appsButton->setChecked(!appsDock->isHidden());
+  });
+  connect(m_appsPane, &ApplicationsPane::typeActivated, this, &MainWindow::revealMime);
+
+  auto *diagnosticsDock = new QDockWidget("Diagnostics", this);
+  diagnosticsDock->setObjectName("DiagnosticsDock");
+  diagnosticsDock->setWidget(new DiagnosticsPanel(diagnosticsDock));
+  addDockWidget(Qt::BottomDockWidgetArea, diagnosticsDock);
+  diagnosticsDock->hide();
+  m_diagnosticsDock = diagnosticsDock;
+  connect(diagnosticsButton, &QPushButton::toggled, diagnosticsDock, &QDockWidget::setVisible);
+  connect(diagnosticsDock, &QDockWidget::visibilityChanged, diagnosticsButton,
+          [diagnosticsButton, diagnosticsDock](bool) {
+            diagnosticsButton->setChecked(!diagnosticsDock->isHidden());
+          });
+
+  m_model = new MimeTypeModel(&m_registry, &m_service, this);
   m_proxy = new MimeTypeFilterProxy(this);
   m_proxy->setSourceModel(m_model);
   m_proxy->setDynamicSortFilter(true);
@@ -195,6 +328,9 @@ void MainWindow::buildUi() {
   m_table->sortByColumn(MimeTypeModel::MimeColumn, Qt::AscendingOrder);
 
   connect(m_search, &QLineEdit::textChanged, this, [this](const QString &text) {
+    if (!text.trimmed().isEmpty()) {
+      m_model->fetchAll();
+    }
     m_proxy->setFilterText(text);
     if (!text.trimmed().isEmpty()) {
       m_table->expandAll();
@@ -203,6 +339,8 @@ void MainWindow::buildUi() {
   connect(m_table->selectionModel(), &QItemSelectionModel::selectionChanged, this,
           &MainWindow::onSelectionChanged);
   connect(m_details, &DetailsPane::requestSetDefault, this, &MainWindow::onRequestSetDefault);
+  connect(m_details, &DetailsPane::requestSetDefaultForApp, this,
+          &MainWindow::onRequestSetDefaultForApp);
 
   populateThemePicker();
   populateAccentPicker();
@@ -240,128 +378,13 @@ void MainWindow::buildUi() {
   });
 }
 
-void MainWindow::loadPalette() {
-  m_themes.clear();
-  m_themeOrder.clear();
-
-  QFile file(":/assets/palette.json");
-  if (!file.open(QIODevice::ReadOnly)) {
-    return;
-  }
-
-  QJsonParseError error;
-  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
-  if (doc.isNull() || !doc.isObject()) {
-    return;
-  }
-
-  QJsonObject root = doc.object();
-  QVector<QPair<int, QString>> order;
-
-  for (auto it = root.begin(); it != root.end(); ++it) {
-    if (!it.value().isObject()) {
-      continue;
-    }
-
-    QJsonObject themeObj = it.value().toObject();
-    if (!themeObj.contains("colors")) {
-      continue;
-    }
-
-    ThemeData theme;
-    theme.id = it.key();
-    theme.name = themeObj.value("name").toString(theme.id);
-    theme.emoji = themeObj.value("emoji").toString();
-    theme.dark = themeObj.value("dark").toBool();
-    theme.order = themeObj.value("order").toInt(0);
-
-    QJsonObject colorsObj = themeObj.value("colors").toObject();
-    for (auto colorIt = colorsObj.begin(); colorIt != colorsObj.end(); ++colorIt) {
-      if (!colorIt.value().isObject()) {
-        continue;
-      }
-
-      QJsonObject colorObj = colorIt.value().toObject();
-      ThemeColor color;
-      color.id = colorIt.key();
-      color.name = colorObj.value("name").toString(color.id);
-      color.hex = colorObj.value("hex").toString();
-      color.accent = colorObj.value("accent").toBool();
-      color.order = colorObj.value("order").toInt(0);
-
-      theme.colors.insert(color.id, color);
-      if (color.accent) {
-        theme.accents.append(color);
-      }
-    }
-
-    std::sort(theme.accents.begin(), theme.accents.end(),
-              [](const ThemeColor &a, const ThemeColor &b) { return a.order < b.order; });
-
-    m_themes.insert(theme.id, theme);
-    order.append({theme.order, theme.id});
-  }
-
-  std::sort(
-      order.begin(), order.end(),
-      [](const QPair<int, QString> &a, const QPair<int, QString> &b) { return a.first < b.first; });
-
-  for (const auto &pair : order) {
-    m_themeOrder.append(pair.second);
-  }
-
-  if (m_themes.isEmpty()) {
-    ThemeData fallback;
-    fallback.id = "mocha";
-    fallback.name = "Mocha";
-    fallback.dark = true;
-    fallback.order = 0;
-
-    auto addColor = [&fallback](const QString &id, const QString &name, const QString &hex,
-                                bool accent, int order) {
-      ThemeColor color;
-      color.id = id;
-      color.name = name;
-      color.hex = hex;
-      color.accent = accent;
-      color.order = order;
-      fallback.colors.insert(id, color);
-      if (accent) {
-        fallback.accents.append(color);
-      }
-    };
-
-    addColor("base", "Base", "#1e1e2e", false, 0);
-    addColor("mantle", "Mantle", "#181825", false, 1);
-    addColor("crust", "Crust", "#11111b", false, 2);
-    addColor("surface0", "Surface 0", "#313244", false, 3);
-    addColor("surface1", "Surface 1", "#45475a", false, 4);
-    addColor("surface2", "Surface 2", "#585b70", false, 5);
-    addColor("overlay0", "Overlay 0", "#6c7086", false, 6);
-    addColor("overlay1", "Overlay 1", "#7f849c", false, 7);
-    addColor("overlay2", "Overlay 2", "#9399b2", false, 8);
-    addColor("text", "Text", "#cdd6f4", false, 9);
-    addColor("subtext0", "Subtext 0", "#a6adc8", false, 10);
-    addColor("subtext1", "Subtext 1", "#bac2de", false, 11);
-    addColor("mauve", "Mauve", "#cba6f7", true, 0);
-
-    std::sort(fallback.accents.begin(), fallback.accents.end(),
-              [](const ThemeColor &a, const ThemeColor &b) { return a.order < b.order; });
-
-    m_themes.insert(fallback.id, fallback);
-    m_themeOrder.append(fallback.id);
-  }
-}
-
 void MainWindow::loadAppearanceSettings() {
-  const QString fallbackTheme = m_themes.contains("mocha")
-                                    ? QString("mocha")
-                                    : (m_themeOrder.isEmpty() ? QString() : m_themeOrder.first());
+  const QString fallbackTheme = QString::fromUtf8(defaultTheme().id);
   const QString fallbackAccent = "mauve";
 
   QSettings settings(settingsFilePath(), QSettings::IniFormat);
   m_currentThemeId = settings.value("appearance/theme", fallbackTheme).toString();
-  if (!m_themes.contains(m_currentThemeId)) {
+  if (!findTheme(m_currentThemeId)) {
     m_currentThemeId = fallbackTheme;
   }
 
@@ -375,7 +398,7 @@ void MainWindow::saveAppearanceSettings() const {
 }
 
 QString MainWindow::settingsFilePath() const {
-  const QString dirPath = XdgPaths::configHome() + "/mime-settings";
+  const QString dirPath = m_env.configHome() + "/mime-settings";
   QDir dir(dirPath);
   if (!dir.exists()) {
     dir.mkpath(".");
@@ -391,11 +414,13 @@ void MainWindow::populateThemePicker() {
   QSignalBlocker blocker(m_themePicker);
   m_themePicker->clear();
 
-  for (const QString &themeId : m_themeOrder) {
-    const ThemeData theme = m_themes.value(themeId);
-    const QString label = theme.name.isEmpty() ? themeId : theme.name;
-    if (!theme.emoji.isEmpty()) {
-      m_themePicker->addItem(makeEmojiIcon(theme.emoji), label, themeId);
+  for (const palette::Theme &theme : palette::kThemes) {
+    const QString themeId = QString::fromUtf8(theme.id);
+    const QString name = QString::fromUtf8(theme.name);
+    const QString emoji = QString::fromUtf8(theme.emoji);
+    const QString label = name.isEmpty() ? themeId : name;
+    if (!emoji.isEmpty()) {
+      m_themePicker->addItem(makeEmojiIcon(emoji), label, themeId);
     } else {
       m_themePicker->addItem(label, themeId);
     }
@@ -417,7 +442,7 @@ void MainWindow::populateAccentPicker() {
     return;
   }
 
-  const ThemeData *theme = currentTheme();
+  const palette::Theme *theme = currentTheme();
   if (!theme) {
     return;
   }
@@ -425,16 +450,18 @@ void MainWindow::populateAccentPicker() {
   QSignalBlocker blocker(m_accentPicker);
   m_accentPicker->clear();
 
-  for (const ThemeColor &accent : theme->accents) {
-    QColor color(accent.hex);
+  for (std::size_t i = 0; i < theme->accentCount; ++i) {
+    const palette::Color &accent = theme->colors[theme->accents[i]];
+    QColor color(QLatin1String(accent.hex));
     QIcon icon = makeAccentIcon(color);
-    const QString label = accent.name.isEmpty() ? accent.id : accent.name;
-    m_accentPicker->addItem(icon, label, accent.id);
+    const QString id = QString::fromUtf8(accent.id);
+    const QString name = QString::fromUtf8(accent.name);
+    m_accentPicker->addItem(icon, name.isEmpty() ? id : name, id);
   }
 
   int index = m_accentPicker->findData(m_currentAccentId);
-  if (index < 0 && !theme->accents.isEmpty()) {
-    m_currentAccentId = theme->accents.first().id;
+  if (index < 0 && theme->accentCount > 0) {
+    m_currentAccentId = QString::fromUtf8(theme->colors[theme->accents[0]].id);
     index = m_accentPicker->findData(m_currentAccentId);
   }
 
@@ -443,43 +470,32 @@ void MainWindow::populateAccentPicker() {
   }
 }
 
-const MainWindow::ThemeData *MainWindow::currentTheme() const {
-  auto it = m_themes.constFind(m_currentThemeId);
-  if (it != m_themes.constEnd()) {
-    return &it.value();
-  }
-
-  if (!m_themeOrder.isEmpty()) {
-    auto fallback = m_themes.constFind(m_themeOrder.first());
-    if (fallback != m_themes.constEnd()) {
-      return &fallback.value();
-    }
-  }
-
-  return nullptr;
+const palette::Theme *MainWindow::currentTheme() const {
+  const palette::Theme *theme = findTheme(m_currentThemeId);
+  return theme ? theme : &palette::kThemes[0];
 }
 
-const MainWindow::ThemeColor *MainWindow::currentAccent(const ThemeData &theme) const {
-  auto it = theme.colors.constFind(m_currentAccentId);
-  if (it != theme.colors.constEnd()) {
-    return &it.value();
+const palette::Color *MainWindow::currentAccent(const palette::Theme &theme) const {
+  const palette::Color *color = findColor(theme, m_currentAccentId);
+  if (color) {
+    return color;
   }
 
-  if (!theme.accents.isEmpty()) {
-    return &theme.accents.first();
+  if (theme.accentCount > 0) {
+    return &theme.colors[theme.accents[0]];
   }
 
   return nullptr;
 }
 
-QString MainWindow::colorFor(const ThemeData &theme, const QString &id,
-                             const QString &fallback) const {
-  auto it = theme.colors.constFind(id);
-  if (it != theme.colors.constEnd() && !it.value().hex.isEmpty()) {
-    return it.value().hex;
+QString MainWindow::colorFor(const palette::Theme &theme, const char *id) const {
+  const QString colorId = QLatin1String(id);
+  const palette::Color *color = findColor(theme, colorId);
+  if (!color || !*color->hex) {
+    color = findColor(defaultTheme(), colorId);
   }
 
-  return fallback;
+  return color ? QString::fromLatin1(color->hex) : QString();
 }
 
 void MainWindow::updateViewportMask() {
@@ -507,38 +523,80 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event) {
   return QMainWindow::eventFilter(obj, event);
 }
 
+void MainWindow::dragEnterEvent(QDragEnterEvent *event) {
+  const QList<QUrl> urls = event->mimeData()->urls();
+  if (!urls.isEmpty() && urls.first().isLocalFile()) {
+    event->acceptProposedAction();
+  }
+}
+
+void MainWindow::dropEvent(QDropEvent *event) {
+  const QList<QUrl> urls = event->mimeData()->urls();
+  if (urls.isEmpty() || !urls.first().isLocalFile()) {
+    return;
+  }
+
+  event->acceptProposedAction();
+  showOpenerFor(urls.first().toLocalFile());
+}
+
 void MainWindow::applyTheme() {
-  const ThemeData *theme = currentTheme();
+  const palette::Theme *theme = currentTheme();
   if (!theme) {
     return;
   }
 
-  const ThemeColor *accent = currentAccent(*theme);
+  const palette::Color *accent = currentAccent(*theme);
   if (!accent) {
     return;
   }
 
-  const QString base = colorFor(*theme, "base", "#1e1e2e");
-  const QString mantle = colorFor(*theme, "mantle", "#181825");
-  const QString crust = colorFor(*theme, "crust", "#11111b");
-  const QString surface0 = colorFor(*theme, "surface0", "#313244");
-  const QString surface1 = colorFor(*theme, "surface1", "#45475a");
-  const QString surface2 = colorFor(*theme, "surface2", "#585b70");
-  const QString overlay1 = colorFor(*theme, "overlay1", "#7f849c");
-  const QString overlay2 = colorFor(*theme, "overlay2", "#9399b2");
-  const QString text = colorFor(*theme, "text", "#cdd6f4");
-  const QString subtext0 = colorFor(*theme, "subtext0", "#a6adc8");
-  const QString subtext1 = colorFor(*theme, "subtext1", "#bac2de");
+  QElapsedTimer timer;
+  timer.start();
 
-  QColor accentColor(accent->hex);
-  const QString accentHex = accentColor.name();
-  const QString accentHover = accentColor.lighter(112).name();
-  const QString accentPressed = accentColor.darker(110).name();
-  const QString hoverBg = blendColors(accentColor, QColor(surface0), 0.22).name();
-  const QString selectionBg = theme->dark ? accentColor.darker(135).name() : accentHex;
-  const QString selectionText = theme->dark ? text : base;
-  const QString groupHeaderBg =
-      theme->dark ? QColor(surface0).darker(115).name() : QColor(surface0).lighter(110).name();
+  // The window-wide sheet only depends on the theme, so an accent change leaves it alone and
+  // re-polishes just the widgets that carry accent rules.
+  const QString themeId = QString::fromUtf8(theme->id);
+  if (m_appliedThemeId != themeId) {
+    auto it = m_themeStyles.constFind(themeId);
+    if (it == m_themeStyles.constEnd()) {
+      it = m_themeStyles.insert(themeId, themeStyleSheet(*theme));
+    }
+    setStyleSheet(it.value());
+    m_appliedThemeId = themeId;
+  }
+
+  const QString accentKey = themeId + '/' + QString::fromUtf8(accent->id);
+  if (m_appliedAccentKey != accentKey) {
+    auto it = m_accentStyles.constFind(accentKey);
+    if (it == m_accentStyles.constEnd()) {
+      it = m_accentStyles.insert(accentKey, accentStyleSheet(*theme, *accent));
+    }
+
+    // Containers rather than leaves, so buttons and lists added to them later pick the sheet up.
+    // The MIME tree is left out on purpose; applyTreeColors() styles it through its palette.
+    const QList<QWidget *> targets = {m_header, m_search, m_details, m_appsDock,
+                                      m_diagnosticsDock};
+    for (QWidget *widget : targets) {
+      widget->setStyleSheet(it.value());
+    }
+    applyTreeColors(*theme, *accent);
+    m_appliedAccentKey = accentKey;
+  }
+
+  qCDebug(lcTheme) << "applied" << accentKey << "in" << timer.nsecsElapsed() / 1000 << "us";
+}
+
+QString MainWindow::themeStyleSheet(const palette::Theme &theme) const {
+  const QString base = colorFor(theme, "base");
+  const QString mantle = colorFor(theme, "mantle");
+  const QString surface0 = colorFor(theme, "surface0");
+  const QString surface1 = colorFor(theme, "surface1");
+  const QString surface2 = colorFor(theme, "surface2");
+  const QString overlay1 = colorFor(theme, "overlay1");
+  const QString text = colorFor(theme, "text");
+  const QString subtext0 = colorFor(theme, "subtext0");
+  const QString subtext1 = colorFor(theme, "subtext1");
 
   QString style;
   style += QString("QMainWindow { background: qlineargradient(x1:0, y1:0, x2:1, "
@@ -556,43 +614,24 @@ void MainWindow::applyTheme() {
   style += QString("QLineEdit, QComboBox { background: %1; border: 1px solid %2; "
                    "border-radius: 8px; padding: 6px 10px; }\n")
                .arg(surface0, surface1);
-  style += QString("QLineEdit:focus, QComboBox:focus { border: 1px solid %1; }\n").arg(accentHex);
   style += QString("QLineEdit::placeholder { color: %1; }\n").arg(subtext0);
   style += QString("QComboBox::drop-down { border-left: 1px solid %1; "
                    "width: 22px; }\n")
                .arg(surface1);
-  style += QString("QComboBox QAbstractItemView { background: %1; border: 1px "
-                   "solid %2; selection-background-color: %3; "
-                   "selection-color: %4; }\n")
-               .arg(surface0, surface1, accentHex, selectionText);
-  style += QString("QTreeView, QListWidget, DetailsPane { background: %1; border: "
+  style += QString("QListWidget, QTableView, DetailsPane { background: %1; border: "
                    "1px solid %2; border-radius: 12px; gridline-color: %3; }\n")
                .arg(surface0, surface1, surface2);
+  // Frame only: an ID rule without sub-controls is matched once per polish, not per item.
+  style += QString("#MimeTable { background: %1; border: 1px solid %2; border-radius: 12px; }\n")
+               .arg(surface0, surface1);
   style += QString("QHeaderView { border: none; border-radius: 0; background: transparent; }\n");
   style += QString("QHeaderView::section { background: %1; padding: 6px; border: "
                    "none; border-bottom: 1px solid %2; color: %3; }\n")
                .arg(surface1, surface2, subtext1);
   style += QString("QHeaderView::section:first { border-top-left-radius: 11px; }\n");
   style += QString("QHeaderView::section:last { border-top-right-radius: 11px; }\n");
-  style += QString("QTreeView::item { padding: 6px 8px; }\n");
-  style += QString("QTreeView::item:alternate { background: %1; }\n").arg(surface1);
-  style += QString("QTreeView::item:has-children { background: %1; }\n").arg(groupHeaderBg);
-  style += QString("QTreeView::item:selected { background: %1; color: %2; }\n")
-               .arg(selectionBg, selectionText);
-  style += QString("QListWidget::item:selected { background: %1; color: %2; "
-                   "border-radius: 6px; }\n")
-               .arg(selectionBg, selectionText);
-  style += QString("QTreeView::item:hover, QListWidget::item:hover { background: "
-                   "%1; }\n")
-               .arg(hoverBg);
   style += QString("QListWidget::item:hover { border-radius: 6px; }\n");
   style += QString("QListWidget::item { padding: 6px; margin: 2px 4px; }\n");
-  style += QString("QPushButton { background: %1; color: %2; border: none; "
-                   "border-radius: 8px; padding: 8px 16px; font-weight: 600; }\n")
-               .arg(accentHex, selectionText);
-  style += QString("QPushButton:hover { background: %1; }\n").arg(accentHover);
-  style += QString("QPushButton:pressed { background: %1; }\n").arg(accentPressed);
-  style += QString("QPushButton:disabled { background: %1; color: %2; }\n").arg(surface2, overlay2);
   style += QString("QSplitter::handle { background: %1; }\n").arg(surface2);
   style += QString("QScrollBar:vertical { background: %1; width: 12px; margin: 0; "
                    "border-top-right-radius: 11px; border-bottom-right-radius: 11px; "
@@ -617,12 +656,87 @@ void MainWindow::applyTheme() {
   style += QString("QLabel#DetailsHint { color: %1; }\n").arg(subtext0);
   style += QString("QLabel#SectionLabel { color: %1; font-weight: 600; }\n").arg(subtext0);
 
-  setStyleSheet(style);
+  return style;
+}
+
+QString MainWindow::accentStyleSheet(const palette::Theme &theme,
+                                     const palette::Color &accent) const {
+  const QString base = colorFor(theme, "base");
+  const QString surface0 = colorFor(theme, "surface0");
+  const QString surface1 = colorFor(theme, "surface1");
+  const QString surface2 = colorFor(theme, "surface2");
+  const QString overlay2 = colorFor(theme, "overlay2");
+  const QString text = colorFor(theme, "text");
+
+  QColor accentColor(QLatin1String(accent.hex));
+  const QString accentHex = accentColor.name();
+  const QString accentHover = accentColor.lighter(112).name();
+  const QString accentPressed = accentColor.darker(110).name();
+  const QString hoverBg = blendColors(accentColor, QColor(surface0), 0.22).name();
+  const QString selectionBg = theme.dark ? accentColor.darker(135).name() : accentHex;
+  const QString selectionText = theme.dark ? text : base;
+
+  // A widget's own sheet wins over the window sheet regardless of specificity, so every rule
+  // touching a property set here (e.g. the disabled push button) must live in this sheet too.
+  QString style;
+  style += QString("QLineEdit:focus, QComboBox:focus { border: 1px solid %1; }\n").arg(accentHex);
+  style += QString("QComboBox QAbstractItemView { background: %1; border: 1px "
+                   "solid %2; selection-background-color: %3; "
+                   "selection-color: %4; }\n")
+               .arg(surface0, surface1, accentHex, selectionText);
+  style += QString("QListWidget::item:selected { background: %1; color: %2; "
+                   "border-radius: 6px; }\n")
+               .arg(selectionBg, selectionText);
+  style += QString("QListWidget::item:hover { background: %1; }\n").arg(hoverBg);
+  style += QString("QTableView { selection-background-color: %1; selection-color: %2; }\n")
+               .arg(selectionBg, selectionText);
+  style += QString("QPushButton { background: %1; color: %2; border: none; "
+                   "border-radius: 8px; padding: 8px 16px; font-weight: 600; }\n")
+               .arg(accentHex, selectionText);
+  style += QString("QPushButton:hover { background: %1; }\n").arg(accentHover);
+  style += QString("QPushButton:pressed { background: %1; }\n").arg(accentPressed);
+  style += QString("QPushButton:disabled { background: %1; color: %2; }\n").arg(surface2, overlay2);
+
+  return style;
+}
+
+void MainWindow::applyTreeColors(const palette::Theme &theme, const palette::Color &accent) {
+  // The tree's items are painted by m_treeDelegate and the view itself by its palette; these
+  // mirror the list rules above. The sheet only draws the tree's frame (#MimeTable).
+  const QColor surface0(colorFor(theme, "surface0"));
+  const QColor accentColor(QLatin1String(accent.hex));
+
+  MimeTreeDelegate::Colors colors;
+  colors.text = QColor(colorFor(theme, "text"));
+  colors.alternate = QColor(colorFor(theme, "surface1"));
+  colors.groupHeader = theme.dark ? surface0.darker(115) : surface0.lighter(110);
+  colors.selection = theme.dark ? accentColor.darker(135) : accentColor;
+  colors.selectionText = theme.dark ? colors.text : QColor(colorFor(theme, "base"));
+  colors.hover = blendColors(accentColor, surface0, 0.22);
+
+  m_treeDelegate->setColors(colors);
+
+  QPalette palette = m_table->palette();
+  palette.setColor(QPalette::Base, surface0);
+  palette.setColor(QPalette::Window, surface0);
+  palette.setColor(QPalette::AlternateBase, colors.alternate);
+  palette.setColor(QPalette::Text, colors.text);
+  palette.setColor(QPalette::WindowText, colors.text);
+  palette.setColor(QPalette::Highlight, colors.selection);
+  palette.setColor(QPalette::HighlightedText, colors.selectionText);
+  m_table->setPalette(palette);
+  m_table->viewport()->update();
 }
 
 void MainWindow::loadData(const QString &preserveMime) {
-  const QVector<MimeEntry> entries = m_service.buildEntries();
-  m_model->setEntries(entries);
+  if (m_snapshot) {
+    m_model->setSnapshot(m_snapshot);
+  } else {
+    m_model->setMimeTypes(m_service.mimeTypeNames());
+  }
+  if (!m_proxy->filterText().isEmpty()) {
+    m_model->fetchAll();
+  }
   m_table->sortByColumn(MimeTypeModel::MimeColumn, Qt::AscendingOrder);
 
   if (!preserveMime.isEmpty()) {
@@ -634,6 +748,27 @@ void MainWindow::loadData(const QString &preserveMime) {
   }
 }
 
+// Re-resolves changed types wherever they are shown; the snapshot no longer matches after this.
+void MainWindow::refreshTypes(const QStringList &mimes) {
+  m_snapshot.reset();
+  m_model->refreshEntries(mimes);
+  if (m_appIndexReady) {
+    m_appIndex.update(m_service.resolveEntries(mimes));
+    m_appsPane->refreshSelection();
+  }
+  onSelectionChanged();
+}
+
+void MainWindow::ensureAppIndex() {
+  if (m_appIndexReady) {
+    return;
+  }
+
+  m_appIndex.reset(m_snapshot ? m_snapshot->allEntries() : m_service.buildEntries());
+  m_appIndexReady = true;
+  m_appsPane->reloadApps();
+}
+
 void MainWindow::selectMime(const QString &mime) {
   const QModelIndex sourceIndex = m_model->indexForMime(mime);
   const QModelIndex proxyIndex = m_proxy->mapFromSource(sourceIndex);
@@ -649,6 +784,42 @@ void MainWindow::selectMime(const QString &mime) {
   }
 }
 
+void MainWindow::bringToFront(const QString &mime) {
+  if (isMinimized()) {
+    showNormal();
+  } else {
+    show();
+  }
+  raise();
+  activateWindow();
+
+  if (!mime.isEmpty()) {
+    revealMime(mime);
+  }
+}
+
+// Like selectMime(), but clears a search that would hide the row.
+void MainWindow::revealMime(const QString &mime) {
+  if (!m_search->text().isEmpty()) {
+    m_search->clear();
+  }
+  selectMime(mime);
+}
+
+// Answers "which application opens this file?" by selecting its type and naming the app.
+void MainWindow::showOpenerFor(const QString &path) {
+  const QString mime = QMimeDatabase().mimeTypeForFile(path).name();
+  const QString appId = MimeAssociationService::effectiveAppFor(m_service.entryFor(mime));
+  const QString fileName = QFileInfo(path).fileName();
+
+  revealMime(mime);
+  statusBar()->showMessage(
+      appId.isEmpty()
+          ? QString("%1 is %2; no application opens it").arg(fileName, mime)
+          : QString("%1 is %2 and opens with %3")
+                .arg(fileName, mime, m_registry.appDisplayName(appId)));
+}
+
 void MainWindow::selectFirstEntry() {
   for (int i = 0; i < m_proxy->rowCount(); ++i) {
     const QModelIndex categoryIndex = m_proxy->index(i, 0);
@@ -656,6 +827,10 @@ void MainWindow::selectFirstEntry() {
       continue;
     }
 
+    if (m_proxy->canFetchMore(categoryIndex)) {
+      m_proxy->fetchMore(categoryIndex);
+    }
+
     const int childCount = m_proxy->rowCount(categoryIndex);
     if (childCount == 0) {
       continue;
@@ -690,7 +865,116 @@ void MainWindow::onSelectionChanged() {
 }
 
 void MainWindow::onRequestSetDefault(const QString &mime, const QString &desktopId) {
+  // The store and the row update right away; the file is written behind on m_writer.
   m_service.setDefault(mime, desktopId);
-  statusBar()->showMessage(QString("Default updated for %1").arg(mime), 3000);
-  loadData(mime);
+  m_writer->enqueue(mime, desktopId);
+  statusBar()->showMessage(QString("Saving default for %1...").arg(mime));
+
+  refreshTypes(QStringList{mime});
+}
+
+void MainWindow::onRequestSetDefaultForApp(const QString &desktopId) {
+  const QString appName = m_registry.appDisplayName(desktopId);
+
+  // Offer the selected type's group as the filter, which is the usual rollout ("video/*").
+  const QModelIndexList selection = m_table->selectionModel()->selectedRows();
+  const MimeEntry current = selection.isEmpty()
+                                ? MimeEntry{}
+                                : m_model->entryForIndex(m_proxy->mapToSource(selection.first()));
+  const QString suggestion =
+      current.mimeType.isEmpty()
+          ? QString()
+          : MimeAssociationService::categoryFor(current.mimeType) + "/*";
+
+  bool accepted = false;
+  const QString pattern = QInputDialog::getText(
+      this, "Default for its types",
+      QString("Make %1 the default for its types matching (empty for all):").arg(appName),
+      QLineEdit::Normal, suggestion, &accepted);
+  if (!accepted) {
+    return;
+  }
+
+  const QStringList changed = m_service.setDefaultForApp(desktopId, pattern.trimmed());
+  if (changed.isEmpty()) {
+    statusBar()->showMessage(QString("%1 is already the default for those types").arg(appName),
+                             3000);
+    return;
+  }
+
+  QVector<QPair<QString, QString>> edits;
+  edits.reserve(changed.size());
+  for (const QString &mime : changed) {
+    edits.append(qMakePair(mime, desktopId));
+  }
+  m_writer->enqueue(edits);
+  statusBar()->showMessage(
+      QString("Saving %1 as default for %2 types...").arg(appName).arg(changed.size()));
+
+  refreshTypes(changed);
+}
+
+void MainWindow::onDefaultsCommitted(const QVector<QPair<QString, QString>> &edits, bool ok,
+                                     const QString &errorString) {
+  const QSet<QString> reverted = m_store.settleUserDefaults(edits);
+
+  if (ok) {
+    statusBar()->showMessage(edits.size() == 1
+                                 ? QString("Default updated for %1").arg(edits.first().first)
+                                 : QString("Defaults updated for %1 types").arg(edits.size()),
+                             3000);
+    m_snapshotWriter->request();
+  } else {
+    statusBar()->showMessage(
+        QString("Could not save %1: %2").arg(m_store.userMimeappsPath(), errorString));
+  }
+
+  if (!reverted.isEmpty()) {
+    onDefaultsChanged(reverted);
+  }
+}
+
+void MainWindow::onDefaultsChanged(const QSet<QString> &keys) {
+  const QStringList affected = m_service.typesAffectedBy(keys);
+  if (affected.isEmpty()) {
+    return;
+  }
+
+  refreshTypes(affected);
+  statusBar()->showMessage(QString("Reloaded defaults for %1 types").arg(affected.size()), 3000);
+  m_snapshotWriter->request();
+}
+
+void MainWindow::onCompactRequested() {
+  // Queued edits go out first so the compactor sees them and the writer reloads afterwards.
+  m_writer->flush();
+
+  const QString path = m_store.userMimeappsPath();
+  const CompactionReport preview = MimeappsCompactor::compact(path, m_registry, true);
+  if (!preview.ok) {
+    QMessageBox::warning(this, "Compact list", MimeappsCompactor::summary(preview));
+    return;
+  }
+
+  if (preview.bytesAfter == preview.bytesBefore) {
+    QMessageBox::information(this, "Compact list", QString("%1 is already compact.").arg(path));
+    return;
+  }
+
+  const QMessageBox::StandardButton answer = QMessageBox::question(
+      this, "Compact list",
+      QString("Rewrite %1?\n\n%2").arg(path, MimeappsCompactor::summary(preview)));
+  if (answer != QMessageBox::Yes) {
+    return;
+  }
+
+  const CompactionReport report = MimeappsCompactor::compact(path, m_registry);
+  statusBar()->showMessage(report.ok ? QString("Compacted %1").arg(path)
+                                     : MimeappsCompactor::summary(report),
+                           5000);
+
+  const QSet<QString> changed = m_store.reloadChangedKeys();
+  if (!changed.isEmpty()) {
+    onDefaultsChanged(changed);
+  }
 }
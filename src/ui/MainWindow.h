@@ -1,38 +1,60 @@
 #pragma once
 
 #include "services/AppRegistry.h"
+#include "services/AppTypeIndex.h"
 #include "services/MimeAssociationService.h"
 #include "services/MimeDefaultsStore.h"
+#include "ui/Palette.h"
+#include "utils/XdgEnvironment.h"
 
 #include <QHash>
 #include <QMainWindow>
+#include <QPair>
+#include <QSet>
 #include <QString>
 #include <QVector>
 
+#include <memory>
+
+class ApplicationsPane;
 class DetailsPane;
+class EntrySnapshot;
+class MimeTreeDelegate;
 class MimeTypeModel;
 class MimeTypeFilterProxy;
 class QComboBox;
+class QDockWidget;
 class QLineEdit;
 class QTreeView;
+class SnapshotWriter;
+class UserDefaultsWriter;
 
 class MainWindow : public QMainWindow {
   Q_OBJECT
 
 public:
-  explicit MainWindow(QWidget *parent = nullptr);
+  explicit MainWindow(const XdgEnvironment &env, QWidget *parent = nullptr);
+
+  // Shows and activates the window, selecting mime when one is given.
+  void bringToFront(const QString &mime = QString());
 
 protected:
   bool eventFilter(QObject *obj, QEvent *event) override;
+  void dragEnterEvent(QDragEnterEvent *event) override;
+  void dropEvent(QDropEvent *event) override;
 
 private slots:
   void onSelectionChanged();
   void onRequestSetDefault(const QString &mime, const QString &desktopId);
+  void onRequestSetDefaultForApp(const QString &desktopId);
+  void onDefaultsChanged(const QSet<QString> &keys);
+  void onDefaultsCommitted(const QVector<QPair<QString, QString>> &edits, bool ok,
+                           const QString &errorString);
+  void onCompactRequested();
 
 private:
   void updateViewportMask();
   void buildUi();
-  void loadPalette();
   void loadAppearanceSettings();
   void saveAppearanceSettings() const;
   void applyTheme();
@@ -40,45 +62,50 @@ private:
   void populateAccentPicker();
   QString settingsFilePath() const;
   void loadData(const QString &preserveMime = QString());
+  void refreshTypes(const QStringList &mimes);
+  void ensureAppIndex();
   void selectMime(const QString &mime);
+  void revealMime(const QString &mime);
+  void showOpenerFor(const QString &path);
   void selectFirstEntry();
 
-  struct ThemeColor {
-    QString id;
-    QString name;
-    QString hex;
-    bool accent = false;
-    int order = 0;
-  };
-
-  struct ThemeData {
-    QString id;
-    QString name;
-    QString emoji;
-    bool dark = false;
-    int order = 0;
-    QHash<QString, ThemeColor> colors;
-    QVector<ThemeColor> accents;
-  };
-
-  const ThemeData *currentTheme() const;
-  const ThemeColor *currentAccent(const ThemeData &theme) const;
-  QString colorFor(const ThemeData &theme, const QString &id, const QString &fallback) const;
+  const palette::Theme *currentTheme() const;
+  const palette::Color *currentAccent(const palette::Theme &theme) const;
+  QString colorFor(const palette::Theme &theme, const char *id) const;
+  QString themeStyleSheet(const palette::Theme &theme) const;
+  QString accentStyleSheet(const palette::Theme &theme, const palette::Color &accent) const;
+  void applyTreeColors(const palette::Theme &theme, const palette::Color &accent);
 
+  XdgEnvironment m_env;
   AppRegistry m_registry;
   MimeDefaultsStore m_store;
   MimeAssociationService m_service;
+  // Valid only until the first change this session; loadData() then resolves live.
+  std::shared_ptr<const EntrySnapshot> m_snapshot;
+  // Built the first time the applications view is shown, then kept in step with every refresh.
+  AppTypeIndex m_appIndex;
+  bool m_appIndexReady = false;
 
+  UserDefaultsWriter *m_writer;
+  // Rebuilds the on-disk snapshot off the GUI thread from committed state only.
+  SnapshotWriter *m_snapshotWriter;
   MimeTypeModel *m_model;
   MimeTypeFilterProxy *m_proxy;
+  QWidget *m_header;
   QLineEdit *m_search;
   QTreeView *m_table;
+  MimeTreeDelegate *m_treeDelegate;
   DetailsPane *m_details;
+  ApplicationsPane *m_appsPane;
+  QDockWidget *m_appsDock;
+  QDockWidget *m_diagnosticsDock;
   QComboBox *m_themePicker;
   QComboBox *m_accentPicker;
-  QHash<QString, ThemeData> m_themes;
-  QVector<QString> m_themeOrder;
   QString m_currentThemeId;
   QString m_currentAccentId;
+  QHash<QString, QString> m_themeStyles;
+  QHash<QString, QString> m_accentStyles;
+  QString m_appliedThemeId;
+  QString m_appliedAccentKey;
   bool m_updatingAppearance = false;
 };
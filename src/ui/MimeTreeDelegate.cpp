@@ -0,0 +1,67 @@
+#include "ui/MimeTreeDelegate.h"
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QPainter>
+
+namespace {
+// Matches the padding the tree used to get from its style sheet.
+constexpr int HorizontalPadding = 8;
+constexpr int VerticalPadding = 6;
+} // namespace
+
+MimeTreeDelegate::MimeTreeDelegate(QObject *parent) : QStyledItemDelegate(parent) {
+}
+
+void MimeTreeDelegate::setColors(const Colors &colors) {
+  m_colors = colors;
+}
+
+void MimeTreeDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                             const QModelIndex &index) const {
+  const bool category = !index.parent().isValid();
+  const bool selected = option.state.testFlag(QStyle::State_Selected);
+
+  // Same precedence the sheet had: hover over selection over group header over alternate.
+  QColor background;
+  if (option.state.testFlag(QStyle::State_MouseOver)) {
+    background = m_colors.hover;
+  } else if (selected) {
+    background = m_colors.selection;
+  } else if (category) {
+    background = m_colors.groupHeader;
+  } else if (option.features.testFlag(QStyleOptionViewItem::Alternate)) {
+    background = m_colors.alternate;
+  }
+
+  if (background.isValid()) {
+    painter->fillRect(option.rect, background);
+  }
+
+  const QString text = index.data(Qt::DisplayRole).toString();
+  if (text.isEmpty()) {
+    return;
+  }
+
+  const QVariant fontData = index.data(Qt::FontRole);
+  const QFont font = fontData.isValid() ? qvariant_cast<QFont>(fontData) : option.font;
+  const QFontMetrics metrics(font);
+  const QRect textRect = option.rect.adjusted(HorizontalPadding, 0, -HorizontalPadding, 0);
+
+  painter->save();
+  painter->setFont(font);
+  painter->setPen(selected ? m_colors.selectionText : m_colors.text);
+  painter->drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+                    metrics.elidedText(text, Qt::ElideRight, textRect.width()));
+  painter->restore();
+}
+
+QSize MimeTreeDelegate::sizeHint(const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const {
+  const QVariant fontData = index.data(Qt::FontRole);
+  const QFontMetrics metrics(fontData.isValid() ? qvariant_cast<QFont>(fontData) : option.font);
+  const QString text = index.data(Qt::DisplayRole).toString();
+
+  return QSize(metrics.horizontalAdvance(text) + 2 * HorizontalPadding,
+               metrics.height() + 2 * VerticalPadding);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QColor>
+#include <QStyledItemDelegate>
+
+// Paints the MIME tree's rows straight from theme colors, so no item rule has to be matched per
+// cell. The tree still inherits the window sheet and thus QStyleSheetStyle; the only rule for it
+// is the #MimeTable frame, so branches and rows fall through to the base style.
+class MimeTreeDelegate : public QStyledItemDelegate {
+  Q_OBJECT
+
+public:
+  struct Colors {
+    QColor text;
+    QColor alternate;
+    QColor groupHeader;
+    QColor selection;
+    QColor selectionText;
+    QColor hover;
+  };
+
+  explicit MimeTreeDelegate(QObject *parent = nullptr);
+
+  void setColors(const Colors &colors);
+
+  void paint(QPainter *painter, const QStyleOptionViewItem &option,
+             const QModelIndex &index) const override;
+  QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+  Colors m_colors;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Layout of the theme tables generated from assets/palette.json (see PaletteData.h).
+namespace palette {
+struct Color {
+  const char *id;
+  const char *name;
+  const char *hex;
+  bool accent;
+  int order;
+};
+
+struct Theme {
+  const char *id;
+  const char *name;
+  const char *emoji;
+  bool dark;
+  int order;
+  const Color *colors;
+  std::size_t colorCount;
+  const int *accents; // Indices into colors, sorted by accent order.
+  std::size_t accentCount;
+};
+} // namespace palette
@@ -0,0 +1,294 @@
+#include "utils/AllocationStats.h"
+
+#ifdef MIME_SETTINGS_ALLOC_STATS
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <unistd.h>
+
+// glibc's own entry points. Defining malloc and friends in the executable interposes them for
+// every shared library, Qt included; these reach the real allocator underneath.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void *__libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+constexpr int MaxPhases = 32;
+// Every block carries its size and owning phase in front of the payload; the header keeps the
+// payload aligned as malloc would.
+constexpr std::size_t HeaderSize =
+    alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : std::size_t(16);
+
+struct BlockHeader {
+  std::size_t size;
+  // Distance from the start of the real block to the payload: HeaderSize, or more for blocks
+  // from the memalign family.
+  std::uint32_t offset;
+  std::int32_t phase;
+};
+
+static_assert(sizeof(BlockHeader) <= HeaderSize, "block header must fit its reserved space");
+
+struct PhaseStats {
+  std::atomic<const char *> name{nullptr};
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes{0};
+  std::atomic<std::int64_t> live{0};
+  std::atomic<std::int64_t> peak{0};
+};
+
+// Slot 0 collects everything allocated outside a phase. Only atomics, a mutex and trivial
+// thread_locals are used here: anything that allocates would recurse into the counters.
+PhaseStats g_phases[MaxPhases];
+std::atomic<int> g_phaseCount{1};
+thread_local int t_currentPhase = 0;
+std::mutex g_registerMutex;
+
+BlockHeader *headerOf(void *payload) {
+  return reinterpret_cast<BlockHeader *>(static_cast<unsigned char *>(payload) - HeaderSize);
+}
+
+void countAlloc(int phase, std::size_t size) {
+  PhaseStats &stats = g_phases[phase];
+  stats.allocations.fetch_add(1, std::memory_order_relaxed);
+  stats.bytes.fetch_add(size, std::memory_order_relaxed);
+  const std::int64_t live =
+      stats.live.fetch_add(std::int64_t(size), std::memory_order_relaxed) + std::int64_t(size);
+  std::int64_t peak = stats.peak.load(std::memory_order_relaxed);
+  while (live > peak &&
+         !stats.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void *track(unsigned char *raw, std::size_t offset, std::size_t size) {
+  if (!raw) {
+    return nullptr;
+  }
+
+  unsigned char *payload = raw + offset;
+  BlockHeader *header = headerOf(payload);
+  header->size = size;
+  header->offset = static_cast<std::uint32_t>(offset);
+  header->phase = t_currentPhase;
+  countAlloc(header->phase, size);
+  return payload;
+}
+
+void untrack(const BlockHeader *header) {
+  g_phases[header->phase].live.fetch_sub(std::int64_t(header->size), std::memory_order_relaxed);
+}
+
+bool overflows(std::size_t size, std::size_t extra) {
+  return size > SIZE_MAX - extra;
+}
+
+void *countedAlloc(std::size_t size) {
+  if (overflows(size, HeaderSize)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  return track(static_cast<unsigned char *>(__libc_malloc(size + HeaderSize)), HeaderSize, size);
+}
+
+void *countedAlignedAlloc(std::size_t alignment, std::size_t size) {
+  if (alignment <= HeaderSize) {
+    return countedAlloc(size);
+  }
+
+  // The payload sits one alignment unit in, so the header still fits right in front of it.
+  if (overflows(size, alignment)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  return track(static_cast<unsigned char *>(__libc_memalign(alignment, size + alignment)),
+               alignment, size);
+}
+
+void countedFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  const BlockHeader *header = headerOf(ptr);
+  untrack(header);
+  __libc_free(static_cast<unsigned char *>(ptr) - header->offset);
+}
+
+bool isPowerOfTwo(std::size_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+struct ReportAtExit {
+  ~ReportAtExit() {
+    std::fprintf(stderr, "%-36s %12s %14s %14s %14s\n", "phase", "allocations", "bytes",
+                 "peak live", "still live");
+
+    const int count = g_phaseCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+      const PhaseStats &stats = g_phases[i];
+      const char *name = i == 0 ? "(outside any phase)" : stats.name.load();
+      std::fprintf(stderr, "%-36s %12llu %14llu %14lld %14lld\n", name,
+                   static_cast<unsigned long long>(stats.allocations.load()),
+                   static_cast<unsigned long long>(stats.bytes.load()),
+                   static_cast<long long>(stats.peak.load()),
+                   static_cast<long long>(stats.live.load()));
+    }
+  }
+};
+
+const ReportAtExit g_reportAtExit;
+} // namespace
+
+AllocationPhase::AllocationPhase(const char *name) {
+  int index = 0;
+  int count = g_phaseCount.load(std::memory_order_acquire);
+  for (int i = 1; i < count && index == 0; ++i) {
+    if (std::strcmp(g_phases[i].name.load(std::memory_order_relaxed), name) == 0) {
+      index = i;
+    }
+  }
+
+  if (index == 0) {
+    const std::lock_guard<std::mutex> lock(g_registerMutex);
+    count = g_phaseCount.load(std::memory_order_relaxed);
+    for (int i = 1; i < count && index == 0; ++i) {
+      if (std::strcmp(g_phases[i].name.load(std::memory_order_relaxed), name) == 0) {
+        index = i;
+      }
+    }
+
+    // Past MaxPhases new names fall back to slot 0 rather than failing.
+    if (index == 0 && count < MaxPhases) {
+      g_phases[count].name.store(name, std::memory_order_relaxed);
+      g_phaseCount.store(count + 1, std::memory_order_release);
+      index = count;
+    }
+  }
+
+  m_previous = t_currentPhase;
+  t_currentPhase = index;
+}
+
+AllocationPhase::AllocationPhase(int index) : m_previous(t_currentPhase) {
+  t_currentPhase = index >= 0 && index < MaxPhases ? index : 0;
+}
+
+AllocationPhase::~AllocationPhase() {
+  t_currentPhase = m_previous;
+}
+
+int AllocationPhase::current() {
+  return t_currentPhase;
+}
+
+// The C allocator is replaced rather than operator new: libstdc++'s operator new and Qt's
+// QArrayData (every QString, QByteArray and QList buffer) both end up here.
+extern "C" {
+void *malloc(std::size_t size) noexcept {
+  return countedAlloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) noexcept {
+  if (size != 0 && count > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  void *ptr = countedAlloc(count * size);
+  if (ptr) {
+    std::memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void *realloc(void *ptr, std::size_t size) noexcept {
+  if (!ptr) {
+    return countedAlloc(size);
+  }
+
+  if (size == 0) {
+    countedFree(ptr);
+    return nullptr;
+  }
+
+  BlockHeader *header = headerOf(ptr);
+  if (header->offset != HeaderSize) {
+    // Over-aligned blocks cannot be resized in place without losing their alignment.
+    void *moved = countedAlloc(size);
+    if (moved) {
+      std::memcpy(moved, ptr, header->size < size ? header->size : size);
+      countedFree(ptr);
+    }
+    return moved;
+  }
+
+  if (overflows(size, HeaderSize)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  // A resize counts as a new allocation owned by the current phase.
+  const BlockHeader old = *header;
+  auto *raw = static_cast<unsigned char *>(
+      __libc_realloc(static_cast<unsigned char *>(ptr) - HeaderSize, size + HeaderSize));
+  if (!raw) {
+    return nullptr;
+  }
+
+  untrack(&old);
+  return track(raw, HeaderSize, size);
+}
+
+void free(void *ptr) noexcept {
+  countedFree(ptr);
+}
+
+void *memalign(std::size_t alignment, std::size_t size) noexcept {
+  return countedAlignedAlloc(alignment, size);
+}
+
+void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  return countedAlignedAlloc(alignment, size);
+}
+
+int posix_memalign(void **out, std::size_t alignment, std::size_t size) noexcept {
+  if (!isPowerOfTwo(alignment) || alignment % sizeof(void *) != 0) {
+    return EINVAL;
+  }
+
+  void *ptr = countedAlignedAlloc(alignment, size);
+  if (!ptr) {
+    return ENOMEM;
+  }
+
+  *out = ptr;
+  return 0;
+}
+
+void *valloc(std::size_t size) noexcept {
+  return countedAlignedAlloc(std::size_t(::sysconf(_SC_PAGESIZE)), size);
+}
+
+void *pvalloc(std::size_t size) noexcept {
+  const std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+  return countedAlignedAlloc(page, (size + page - 1) & ~(page - 1));
+}
+
+// Callers may use the whole usable size; the requested size is a valid answer.
+std::size_t malloc_usable_size(void *ptr) noexcept {
+  return ptr ? headerOf(ptr)->size : 0;
+}
+}
+
+#endif
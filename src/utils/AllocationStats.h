@@ -0,0 +1,46 @@
+#pragma once
+
+// Opt-in allocation accounting, enabled with -DMIME_SETTINGS_ALLOC_STATS=ON. The build then
+// interposes the C allocator (malloc, calloc, realloc, free and the memalign family) with a
+// counting one and prints, at exit, the allocations, bytes and peak live bytes of every phase
+// opened with ALLOCATION_PHASE. Interposing at the C level covers operator new as well as the
+// QArrayData buffers behind QString, QByteArray and QList, which never go through new. glibc
+// only: the real allocator is reached through its __libc_* entry points.
+//
+// Phases nest per thread, so concurrent phases on different threads do not disturb each other.
+// A pool task starts outside any phase; the code that queues it captures the current phase with
+// ALLOCATION_PHASE_CAPTURE(var) and the task reopens it with ALLOCATION_PHASE_ADOPT(var).
+// A realloc is counted as a new allocation in the phase that resizes the block.
+// Without the option the macros expand to nothing.
+#ifdef MIME_SETTINGS_ALLOC_STATS
+
+class AllocationPhase {
+public:
+  // name must outlive the process, e.g. a string literal.
+  explicit AllocationPhase(const char *name);
+  // Reopens a phase returned by current(), typically on a pool thread.
+  explicit AllocationPhase(int index);
+  ~AllocationPhase();
+
+  static int current();
+
+  AllocationPhase(const AllocationPhase &) = delete;
+  AllocationPhase &operator=(const AllocationPhase &) = delete;
+
+private:
+  int m_previous;
+};
+
+#define ALLOCATION_PHASE(name) const AllocationPhase allocationPhase(name)
+#define ALLOCATION_PHASE_CAPTURE(var) const int var = AllocationPhase::current()
+#define ALLOCATION_PHASE_ADOPT(var) const AllocationPhase allocationPhase(var)
+
+#else
+
+#define ALLOCATION_PHASE(name)                                                                    \
+  do {                                                                                            \
+  } while (false)
+#define ALLOCATION_PHASE_CAPTURE(var) const int var = 0
+#define ALLOCATION_PHASE_ADOPT(var) static_cast<void>(var)
+
+#endif
@@ -0,0 +1,39 @@
+#include "utils/BufferedWriter.h"
+
+#include <QIODevice>
+
+BufferedWriter::BufferedWriter(QIODevice *device, qsizetype capacity)
+    : m_device(device), m_capacity(capacity) {
+  m_buffer.reserve(m_capacity);
+}
+
+BufferedWriter::~BufferedWriter() {
+  flush();
+}
+
+void BufferedWriter::write(const QByteArray &data) {
+  if (m_buffer.size() + data.size() > m_capacity) {
+    flush();
+  }
+
+  // A record larger than the whole buffer goes straight through.
+  if (data.size() > m_capacity) {
+    m_failed = m_failed || m_device->write(data) != data.size();
+    return;
+  }
+
+  m_buffer.append(data);
+}
+
+bool BufferedWriter::flush() {
+  if (!m_buffer.isEmpty()) {
+    m_failed = m_failed || m_device->write(m_buffer) != m_buffer.size();
+    m_buffer.resize(0); // Unlike clear(), keeps the allocation.
+  }
+
+  return !m_failed;
+}
+
+QString BufferedWriter::errorString() const {
+  return m_device->errorString();
+}
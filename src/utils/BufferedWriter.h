@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+// Fixed-capacity write buffer in front of a device. Records are appended whole and the buffer
+// is drained whenever it fills, so memory stays at the capacity however much is written.
+class BufferedWriter {
+public:
+  explicit BufferedWriter(QIODevice *device, qsizetype capacity = 256 * 1024);
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter &) = delete;
+  BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+  void write(const QByteArray &data);
+  // Drains the buffer; false once any write has failed.
+  bool flush();
+  QString errorString() const;
+
+private:
+  QIODevice *m_device;
+  qsizetype m_capacity;
+  QByteArray m_buffer;
+  bool m_failed = false;
+};
@@ -0,0 +1,27 @@
+#include "utils/FileStamp.h"
+
+#include <QFile>
+
+#include <sys/stat.h>
+
+FileStamp FileStamp::of(const QString &path) {
+  FileStamp stamp;
+  struct stat st;
+  if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+    stamp.exists = true;
+    stamp.size = st.st_size;
+    stamp.mtimeNs = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.inode = st.st_ino;
+  }
+
+  return stamp;
+}
+
+bool FileStamp::operator==(const FileStamp &other) const {
+  return exists == other.exists && size == other.size && mtimeNs == other.mtimeNs &&
+         inode == other.inode;
+}
+
+bool FileStamp::operator!=(const FileStamp &other) const {
+  return !(*this == other);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// What stat() says about a file's contents. Anything derived from the file stays valid while
+// size, nanosecond mtime and inode all match; an atomic replace changes the inode even when
+// size and mtime collide. A missing file has a stamp of its own, so its absence caches too.
+struct FileStamp {
+  bool exists = false;
+  qint64 size = 0;
+  qint64 mtimeNs = 0;
+  quint64 inode = 0;
+
+  static FileStamp of(const QString &path);
+
+  bool operator==(const FileStamp &other) const;
+  bool operator!=(const FileStamp &other) const;
+};
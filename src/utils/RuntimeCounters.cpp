@@ -0,0 +1,56 @@
+#include "utils/RuntimeCounters.h"
+
+#include <QStringList>
+
+#include <atomic>
+
+namespace {
+std::atomic<quint64> g_values[RuntimeCounters::CounterCount];
+
+// Indexed by RuntimeCounters::Counter.
+const char *const CounterNames[RuntimeCounters::CounterCount] = {
+    "Desktop files parsed",
+    "mimeinfo.cache hits",
+    "mimeinfo.cache misses",
+    "mimeapps.list reads",
+    "mimeapps.list reuses",
+    "Snapshot hits",
+    "Snapshot misses",
+    "Resolutions",
+    "Model resets",
+    "Filter passes",
+    "Filter time",
+    "Icon lookups",
+};
+} // namespace
+
+void RuntimeCounters::add(Counter counter, quint64 amount) {
+  g_values[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+quint64 RuntimeCounters::value(Counter counter) {
+  return g_values[counter].load(std::memory_order_relaxed);
+}
+
+QString RuntimeCounters::name(Counter counter) {
+  return QString::fromLatin1(CounterNames[counter]);
+}
+
+QString RuntimeCounters::formattedValue(Counter counter) {
+  const quint64 count = value(counter);
+  if (counter == FilterNanoseconds) {
+    return QString("%1 ms").arg(double(count) / 1e6, 0, 'f', 2);
+  }
+
+  return QString::number(count);
+}
+
+QString RuntimeCounters::report() {
+  QStringList lines;
+  for (int i = 0; i < CounterCount; ++i) {
+    const auto counter = static_cast<Counter>(i);
+    lines << QString("%1: %2").arg(name(counter), formattedValue(counter));
+  }
+
+  return lines.join('\n');
+}
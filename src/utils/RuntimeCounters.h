@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// Process-wide event counters for the caches and incremental paths. Each counter is a single
+// relaxed atomic, so bumping one from a resolver thread costs no more than an uncontended add.
+class RuntimeCounters {
+public:
+  enum Counter {
+    DesktopFilesParsed,
+    MimeinfoCacheHits,
+    MimeinfoCacheMisses,
+    MimeappsListsRead,
+    MimeappsListsReused,
+    SnapshotHits,
+    SnapshotMisses,
+    Resolutions,
+    ModelResets,
+    FilterPasses,
+    FilterNanoseconds,
+    IconLookups,
+    CounterCount
+  };
+
+  static void add(Counter counter, quint64 amount = 1);
+  static quint64 value(Counter counter);
+  static QString name(Counter counter);
+  // The value as shown to people; durations are converted to milliseconds.
+  static QString formattedValue(Counter counter);
+  // One "name: value" line per counter.
+  static QString report();
+};
@@ -0,0 +1,88 @@
+#include "utils/SingleInstance.h"
+
+#include <QDataStream>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <unistd.h>
+
+namespace {
+constexpr int ConnectTimeoutMs = 500;
+// Only tells a live owner from a stale socket file, so it can be short.
+constexpr int ProbeTimeoutMs = 200;
+// Generous, since the running instance may be busy; a launch that times out starts its own.
+constexpr int AckTimeoutMs = 2000;
+constexpr char Ack = '\x06';
+} // namespace
+
+SingleInstance::SingleInstance(const QString &serverName, QObject *parent)
+    : QObject(parent), m_serverName(serverName), m_server(new QLocalServer(this)) {
+  m_server->setSocketOptions(QLocalServer::UserAccessOption);
+  connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+}
+
+QString SingleInstance::defaultServerName() {
+  return QString("mime-settings-%1").arg(::getuid());
+}
+
+bool SingleInstance::forward(const QString &serverName, const QStringList &arguments) {
+  QLocalSocket socket;
+  socket.connectToServer(serverName);
+  if (!socket.waitForConnected(ConnectTimeoutMs)) {
+    return false;
+  }
+
+  QDataStream out(&socket);
+  out << arguments;
+  if (!socket.waitForBytesWritten(ConnectTimeoutMs)) {
+    return false;
+  }
+
+  while (socket.bytesAvailable() == 0) {
+    if (!socket.waitForReadyRead(AckTimeoutMs)) {
+      return false;
+    }
+  }
+
+  char reply = 0;
+  return socket.getChar(&reply) && reply == Ack;
+}
+
+bool SingleInstance::listen() {
+  if (m_server->listen(m_serverName)) {
+    return true;
+  }
+
+  // A live instance answers; only a stale socket file may be taken over.
+  QLocalSocket probe;
+  probe.connectToServer(m_serverName);
+  if (probe.waitForConnected(ProbeTimeoutMs)) {
+    return false;
+  }
+
+  QLocalServer::removeServer(m_serverName);
+  return m_server->listen(m_serverName);
+}
+
+void SingleInstance::onNewConnection() {
+  while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+    connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+      // The list may arrive in pieces; a transaction rolls back until it is complete.
+      QDataStream in(socket);
+      in.startTransaction();
+      QStringList arguments;
+      in >> arguments;
+      if (!in.commitTransaction()) {
+        if (in.status() == QDataStream::ReadCorruptData) {
+          socket->abort();
+        }
+        return;
+      }
+
+      socket->putChar(Ack);
+      socket->disconnectFromServer();
+      emit argumentsReceived(arguments);
+    });
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QLocalServer;
+
+// Lets a second launch hand its arguments to the window that is already running instead of
+// paying for a cold start. The first instance listens on a per-user local socket; later ones
+// connect, send their arguments, wait for the acknowledgement and exit.
+class SingleInstance : public QObject {
+  Q_OBJECT
+
+public:
+  explicit SingleInstance(const QString &serverName, QObject *parent = nullptr);
+
+  static QString defaultServerName();
+  // True once a running instance has acknowledged the arguments.
+  static bool forward(const QString &serverName, const QStringList &arguments);
+
+  // Replaces a socket left behind by a dead instance; fails while another instance answers.
+  bool listen();
+
+signals:
+  void argumentsReceived(const QStringList &arguments);
+
+private:
+  void onNewConnection();
+
+  QString m_serverName;
+  QLocalServer *m_server;
+};
@@ -0,0 +1,149 @@
+#include "utils/XdgEnvironment.h"
+
+#include "utils/XdgPaths.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+XdgEnvironment XdgEnvironment::fromProcess(const QString &rootPrefix) {
+  XdgEnvironment env;
+
+  const QString root = QDir::cleanPath(rootPrefix);
+  if (!rootPrefix.isEmpty() && root != "/") {
+    env.m_rootPrefix = root;
+  }
+
+  env.m_homePath = env.underRoot(QDir::homePath());
+
+  if (env.m_rootPrefix.isEmpty()) {
+    env.m_configDirs = env.existingDirs(XdgPaths::configDirs());
+    env.m_dataDirs = env.existingDirs(XdgPaths::dataDirs());
+    env.m_executableDirs = env.existingDirs(XdgPaths::executableDirs());
+    env.resolveSystemAppDirs();
+    env.resolveUserDirs(XdgPaths::configHome(), XdgPaths::dataHome(), XdgPaths::cacheHome());
+  } else {
+    env.m_configDirs = env.existingDirs({"/etc/xdg"});
+    env.m_dataDirs = env.existingDirs({"/usr/local/share", "/usr/share"});
+    env.m_executableDirs = env.existingDirs(
+        {"/usr/local/sbin", "/usr/local/bin", "/usr/sbin", "/usr/bin", "/sbin", "/bin"});
+    env.resolveSystemAppDirs();
+    env.resolveUserDirs(env.m_homePath + "/.config", env.m_homePath + "/.local/share",
+                        env.m_homePath + "/.cache");
+  }
+
+  return env;
+}
+
+XdgEnvironment XdgEnvironment::withHome(const QString &homePath) const {
+  XdgEnvironment env = *this;
+  env.m_homePath = underRoot(QDir::cleanPath(homePath));
+  env.resolveUserDirs(env.m_homePath + "/.config", env.m_homePath + "/.local/share",
+                      env.m_homePath + "/.cache");
+  return env;
+}
+
+XdgEnvironment XdgEnvironment::withCurrentAppDirs() const {
+  XdgEnvironment env = *this;
+  env.resolveSystemAppDirs();
+  env.resolveUserDirs(m_configHome, m_dataHome, m_cacheHome);
+  return env;
+}
+
+QString XdgEnvironment::rootPrefix() const {
+  return m_rootPrefix;
+}
+
+QString XdgEnvironment::homePath() const {
+  return m_homePath;
+}
+
+QString XdgEnvironment::configHome() const {
+  return m_configHome;
+}
+
+QStringList XdgEnvironment::configDirs() const {
+  return m_configDirs;
+}
+
+QString XdgEnvironment::dataHome() const {
+  return m_dataHome;
+}
+
+QStringList XdgEnvironment::dataDirs() const {
+  return m_dataDirs;
+}
+
+QStringList XdgEnvironment::appDirs() const {
+  return m_appDirs;
+}
+
+QString XdgEnvironment::userAppDir() const {
+  return m_dataHome + "/applications";
+}
+
+QStringList XdgEnvironment::systemAppDirs() const {
+  return m_systemAppDirs;
+}
+
+QString XdgEnvironment::cacheHome() const {
+  return m_cacheHome;
+}
+
+QStringList XdgEnvironment::executableDirs() const {
+  return m_executableDirs;
+}
+
+QString XdgEnvironment::userMimeappsPath() const {
+  return m_configHome + "/mimeapps.list";
+}
+
+QString XdgEnvironment::underRoot(const QString &path) const {
+  if (m_rootPrefix.isEmpty() || path.isEmpty()) {
+    return path;
+  }
+
+  return m_rootPrefix + QDir::cleanPath("/" + path);
+}
+
+QStringList XdgEnvironment::existingDirs(const QStringList &paths) const {
+  QStringList result;
+
+  for (const QString &dir : paths) {
+    const QString path = underRoot(dir);
+
+    if (!path.isEmpty() && QFileInfo(path).isDir()) {
+      result.append(path);
+    }
+  }
+
+  result.removeDuplicates();
+  return result;
+}
+
+void XdgEnvironment::resolveSystemAppDirs() {
+  m_systemAppDirs.clear();
+
+  for (const QString &dir : m_dataDirs) {
+    const QString path = dir + "/applications";
+
+    if (QFileInfo(path).isDir()) {
+      m_systemAppDirs.append(path);
+    }
+  }
+}
+
+void XdgEnvironment::resolveUserDirs(const QString &configHome, const QString &dataHome,
+                                     const QString &cacheHome) {
+  m_configHome = configHome;
+  m_dataHome = dataHome;
+  m_cacheHome = cacheHome;
+
+  m_appDirs.clear();
+  const QString userApps = userAppDir();
+  if (QFileInfo(userApps).isDir()) {
+    m_appDirs.append(userApps);
+  }
+
+  m_appDirs.append(m_systemAppDirs);
+  m_appDirs.removeDuplicates();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Immutable snapshot of the XDG directories the services read. Everything is resolved and
+// stat'ed once at construction, so the services never consult the process environment or the
+// filesystem to find their roots.
+//
+// With a root prefix every path is taken inside that tree and the process XDG_* variables are
+// ignored in favour of the spec defaults, so tooling can point the whole pipeline at a synthetic
+// or mounted system without touching its own environment.
+class XdgEnvironment {
+public:
+  XdgEnvironment() = default;
+
+  static XdgEnvironment fromProcess(const QString &rootPrefix = QString());
+
+  // Same system directories, user directories derived from another home inside the root.
+  XdgEnvironment withHome(const QString &homePath) const;
+  // Same roots with the application directories stat'ed again, for long-lived processes that
+  // must notice an applications directory created or removed after startup.
+  XdgEnvironment withCurrentAppDirs() const;
+
+  QString rootPrefix() const;
+  QString homePath() const;
+  QString configHome() const;
+  QStringList configDirs() const;
+  QString dataHome() const;
+  QStringList dataDirs() const;
+  QStringList appDirs() const;
+  QString userAppDir() const;
+  QStringList systemAppDirs() const;
+  QString cacheHome() const;
+  QStringList executableDirs() const;
+  QString userMimeappsPath() const;
+
+private:
+  QString underRoot(const QString &path) const;
+  QStringList existingDirs(const QStringList &paths) const;
+  void resolveSystemAppDirs();
+  // Takes paths that already include the root prefix.
+  void resolveUserDirs(const QString &configHome, const QString &dataHome,
+                       const QString &cacheHome);
+
+  QString m_rootPrefix;
+  QString m_homePath;
+  QString m_configHome;
+  QStringList m_configDirs;
+  QString m_dataHome;
+  QStringList m_dataDirs;
+  QStringList m_systemAppDirs;
+  QStringList m_appDirs;
+  QString m_cacheHome;
+  QStringList m_executableDirs;
+};
@@ -1,7 +1,6 @@
 #include "utils/XdgPaths.h"
 
 #include <QDir>
-#include <QFileInfo>
 
 QString XdgPaths::configHome() {
   QString value = qEnvironmentVariable("XDG_CONFIG_HOME");
@@ -20,15 +19,10 @@ QStringList XdgPaths::configDirs() {
     value = "/etc/xdg";
   }
 
-  QStringList dirs = splitPaths(value);
   QStringList result;
-
+  const QStringList dirs = splitPaths(value);
   for (const QString &dir : dirs) {
-    QString path = expandHome(dir);
-
-    if (!path.isEmpty() && QDir(path).exists()) {
-      result.append(path);
-    }
+    result.append(expandHome(dir));
   }
   return result;
 }
@@ -50,37 +44,36 @@ QStringList XdgPaths::dataDirs() {
     value = "/usr/local/share:/usr/share";
   }
 
-  QStringList dirs = splitPaths(value);
   QStringList result;
-
+  const QStringList dirs = splitPaths(value);
   for (const QString &dir : dirs) {
-    QString path = expandHome(dir);
-
-    if (!path.isEmpty() && QDir(path).exists()) {
-      result.append(path);
-    }
+    result.append(expandHome(dir));
   }
   return result;
 }
 
-QStringList XdgPaths::appDirs() {
-  QStringList result;
-  QString userApps = dataHome() + "/applications";
+QString XdgPaths::cacheHome() {
+  QString value = qEnvironmentVariable("XDG_CACHE_HOME");
 
-  if (QDir(userApps).exists()) {
-    result.append(userApps);
+  if (value.isEmpty()) {
+    return QDir::homePath() + "/.cache";
   }
 
-  const QStringList data = dataDirs();
-  for (const QString &dir : data) {
-    QString path = dir + "/applications";
+  return expandHome(value);
+}
 
-    if (QDir(path).exists()) {
-      result.append(path);
-    }
+QStringList XdgPaths::executableDirs() {
+  QString value = qEnvironmentVariable("PATH");
+
+  if (value.isEmpty()) {
+    value = "/usr/local/bin:/usr/bin:/bin";
   }
 
-  result.removeDuplicates();
+  QStringList result;
+  const QStringList dirs = splitPaths(value);
+  for (const QString &dir : dirs) {
+    result.append(expandHome(dir));
+  }
   return result;
 }
 
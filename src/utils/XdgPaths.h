@@ -3,15 +3,18 @@
 #include <QString>
 #include <QStringList>
 
+// Raw XDG base directory values from the process environment, with the spec defaults applied.
+// Nothing here touches the filesystem; see XdgEnvironment for the resolved snapshot.
 class XdgPaths {
 public:
   static QString configHome();
   static QStringList configDirs();
   static QString dataHome();
   static QStringList dataDirs();
-  static QStringList appDirs();
+  static QString cacheHome();
+  // $PATH, for resolving TryExec names.
+  static QStringList executableDirs();
 
-private:
   static QString expandHome(const QString &path);
   static QStringList splitPaths(const QString &value);
 };